@@ -146,6 +146,7 @@ void CSVWriterNode::process()
 {
   auto& geom_term = input("geometry");
   size_t N = geom_term.size();
+  dictionaries_ = attribute_dictionaries(poly_input("attributes"), poly_input("attribute_dictionaries"));
 
   auto file_path = manager.substitute_globals(filepath);
   auto parent_path = fs::path(file_path).parent_path();
@@ -239,7 +240,11 @@ void CSVWriterNode::print_attributes(std::ofstream& f_out, const size_t& i) {
         } else if (term->accepts_type(typeid(float))) {
           f_out << term->get<float>(i) << separator;
         } else if (term->accepts_type(typeid(int))) {
-          f_out << term->get<int>(i) << separator;
+          auto dictionary = dictionaries_.find(term->get_full_name());
+          if (dictionary != dictionaries_.end())
+            f_out << dictionary->second->get<std::string>(term->get<int>(i)) << separator;
+          else
+            f_out << term->get<int>(i) << separator;
         } else if (term->accepts_type(typeid(std::string))) {
           f_out << term->get<std::string>(i) << separator;
         }
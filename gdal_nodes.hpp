@@ -17,45 +17,322 @@
 
 #include <ogrsf_frmts.h>
 
+#include <filesystem>
+#include <functional>
+#include <list>
+#include <map>
+#include <mutex>
+#include <optional>
+
 namespace geoflow::nodes::gdal
 {
 
+/// An attribute column decoded from an OGR layer
+struct OGRAttributeColumn {
+  std::string name;
+  std::type_index type;
+  // OGR field index, -1 for the feature ID
+  int field_index;
+  std::vector<std::any> values;
+  // appends the value of field_index of a feature to values
+  void (*decode)(const OGRFeature&, OGRAttributeColumn&) = nullptr;
+  // dictionary encoded string column, values are int codes into dictionary
+  bool is_dictionary = false;
+  vec1s dictionary;
+  std::unordered_map<std::string, int> dictionary_codes;
+};
+
+/// Geometries and attributes decoded from one OGR layer. Coordinates are still
+/// in the layer CRS, they are transformed when the data is pushed to the
+/// output terminals.
+struct OGRLayerData {
+  std::string layer_name;
+  std::string geometry_type_name;
+  std::string srs_wkt;
+  // GDAL driver of the source, its attribute filters determine how LIKE is
+  // evaluated in memory
+  std::string driver_name;
+  // rings of each polygon, exterior ring first, without the closing point
+  std::vector<std::vector<std::vector<arr3d>>> polygons;
+  std::vector<std::vector<arr3d>> line_strings;
+  std::vector<arr3d> points;
+  // meshes (polygons of rings, without closing points) and their polygon
+  // labels, read instead of polygons in read_meshes mode
+  std::vector<std::vector<std::vector<std::vector<arr3d>>>> meshes;
+  std::vector<std::vector<int>> mesh_labels;
+  int labels_field = -1;
+  vec1s wkt;
+  vec1f area;
+  vec1b is_valid;
+  // source feature of each polygon or line string, counted from 0
+  std::vector<int> feature_index;
+  // number of features that produced output
+  size_t n_features = 0;
+  // polygons that were skipped because their exterior ring has less than 4
+  // points
+  size_t n_degenerate = 0;
+  std::vector<OGRAttributeColumn> columns;
+  // spatial sharding: only rows whose first vertex lies in [minx, maxx) x
+  // [miny, maxy) belong to this shard
+  bool has_shard_box = false;
+  std::array<double, 4> shard_box;
+};
+
+/// Evaluates the WHERE clause of an attribute_filter against the decoded
+/// columns of an OGRLayerData, so that a layer that is kept in memory can be
+/// filtered again without reading it. Supports the common subset of OGR SQL:
+/// comparisons, AND, OR, NOT, IN, BETWEEN, LIKE, ILIKE, IS [NOT] NULL and
+/// arithmetic on numbers. Comparisons with NULL are unknown, as in SQL. LIKE
+/// is matched the way the driver of the data does, case insensitive for the
+/// SQLite based drivers.
+class OGRAttributeFilter {
+public:
+  struct Node;
+  // throws a gfException if the expression cannot be parsed
+  explicit OGRAttributeFilter(const std::string& expression);
+  ~OGRAttributeFilter();
+  // looks up the columns of the expression in data, returns false if a column
+  // is missing or if LIKE is used and it is not known how the driver of the
+  // data evaluates it
+  bool bind(const OGRLayerData& data);
+  // whether attribute row i of the data passed to bind satisfies the
+  // expression
+  bool evaluate(size_t i) const;
+  // the identifiers in an OGR SQL expression, which includes keywords and
+  // function names. Throws a gfException if the expression cannot be
+  // tokenized.
+  static std::vector<std::string> identifiers(const std::string& expression);
+
+private:
+  std::unique_ptr<Node> root_;
+};
+
+/// Map the dictionary encoded int attributes (see OGRLoaderNode) to their
+/// dictionary, which has the same name in the attribute_dictionaries input
+inline std::unordered_map<std::string, gfSingleFeatureOutputTerminal*> attribute_dictionaries(gfMultiFeatureInputTerminal& attributes, gfMultiFeatureInputTerminal& dictionaries)
+{
+  std::unordered_map<std::string, gfSingleFeatureOutputTerminal*> result;
+  for (auto& dictionary : dictionaries.sub_terminals()) {
+    for (auto& term : attributes.sub_terminals()) {
+      if (term->get_name() == dictionary->get_name() && term->accepts_type(typeid(int)))
+        result[term->get_full_name()] = dictionary;
+    }
+  }
+  return result;
+}
+
+/// A dataset path and the layer to read from it
+struct OGRSource {
+  std::string path;
+  std::string layer_name;
+  // use layer_id if the layer is not found by name
+  bool fallback_to_id;
+  // throw if the layer is not found, otherwise the file is skipped
+  bool required;
+};
+
+/// A read-only dataset from the OGRDatasetPool, with the metadata of the layers
+/// that have been read from it
+struct OGRPooledDataset {
+  std::string path;
+  std::filesystem::file_time_type mtime;
+  GDALDatasetUniquePtr ds;
+  // layer SRS exported to WKT, by layer name
+  std::unordered_map<std::string, std::string> srs_wkt;
+  // closed instead of returned to the pool when it is released
+  bool pooled = true;
+};
+
+/// Returns a dataset to the pool when it is no longer used
+struct OGRDatasetReleaser {
+  void operator()(OGRPooledDataset* dataset) const;
+};
+using OGRDatasetPtr = std::unique_ptr<OGRPooledDataset, OGRDatasetReleaser>;
+
+/// Process wide pool of open read-only datasets, so that repeated runs do not
+/// need to open the same dataset again. A dataset is used by one thread at a
+/// time, it is taken out of the pool while it is in use. The least recently
+/// used datasets are closed when more than capacity datasets are idle, and
+/// datasets of files that have been modified are never reused. The pool is
+/// empty until a capacity is set, and only nodes that opt in use it.
+class OGRDatasetPool {
+  std::mutex mutex_;
+  // idle datasets, most recently used first
+  std::list<std::unique_ptr<OGRPooledDataset>> idle_;
+  size_t capacity_ = 0;
+  // FID range of the layers of files, by path and layer name, with the
+  // modification time of the file it was determined for
+  struct FIDRange {
+    std::filesystem::file_time_type mtime;
+    GIntBig min, max;
+  };
+  std::map<std::pair<std::string, std::string>, FIDRange> fid_ranges_;
+
+public:
+  static OGRDatasetPool& instance();
+  // an unpooled dataset is always opened, and closed when it is released
+  OGRDatasetPtr open(const std::string& path, bool pooled = true);
+  void release(OGRPooledDataset* dataset);
+  void set_capacity(size_t capacity);
+  // The FID range of a layer of a file without an FID column takes a scan
+  // of the file, it is kept for the following runs and shards, whether the
+  // dataset is pooled or not. Returns false if it is not known for the
+  // current version of the file.
+  bool get_fid_range(const OGRPooledDataset& dataset, const std::string& layer_name, GIntBig& min, GIntBig& max);
+  void set_fid_range(const OGRPooledDataset& dataset, const std::string& layer_name, GIntBig min, GIntBig max);
+};
+
 class OGRLoaderNode : public Node
 {
-  int layer_count = 0;
   int layer_id = 0;
+  int n_threads_ = 0;
+  int batch_size_ = 0;
+  float batch_size_mb_ = 0;
   std::string layer_name_ = "";
   std::string attribute_filter_ = "";
+  std::string spatial_filter_bbox_ = "";
+  std::string fields_ = "";
+  std::string dictionary_fields_ = "";
+  bool ignore_geometry_ = false;
+  bool attributes_per_feature_ = false;
+  bool read_meshes_ = false;
   float base_elevation = 0;
   bool output_fid_ = false;
+  bool use_arrow_stream_ = false;
+  bool force_optional_outputs_ = false;
+  bool parallel_decode_ = false;
+  int validity_mode_ = 2;
+  std::string cache_dir_ = "";
+  int shard_index_ = 0;
+  int shard_count_ = 0;
+  bool shard_spatial_ = false;
+  int dataset_pool_size_ = 0;
+  bool keep_in_memory_ = false;
 
   std::string filepath = "";
 
-  std::string geometry_type_name;
-  OGRwkbGeometryType geometry_type;
-
-  void push_attributes(const OGRFeature &poFeature, std::unordered_map<std::string,int>& fieldNameMap);
-  void read_polygon(OGRPolygon* poPolygon);
+  // what to compute for the optional outputs in the current run
+  enum class ValidityCheck { OFF = 0, FAST = 1, GEOS = 2 };
+  bool compute_wkt_ = true;
+  bool compute_area_ = true;
+  bool compute_feature_index_ = true;
+  ValidityCheck validity_check_ = ValidityCheck::GEOS;
+  size_t decode_threads_ = 0;
+  vec1s selected_fields_;
+  vec1s dictionary_fields_list_;
+  std::string cache_key_;
+
+  // attribute terminals by name and the number of attribute rows pushed so far
+  std::unordered_map<std::string, gfSingleFeatureOutputTerminal*> attribute_terms_;
+  size_t attribute_rows_ = 0;
+  size_t feature_rows_ = 0;
+  // global dictionary codes of the dictionary encoded columns in this run
+  std::unordered_map<std::string, std::unordered_map<std::string, int>> dictionary_codes_;
+  std::unordered_map<std::string, gfSingleFeatureOutputTerminal*> dictionary_terms_;
+  // points of the point layers in this run, with their attributes
+  PointCollection points_;
+  // CRS of the forward transformation set up in this run
+  std::string pushed_srs_wkt_;
+
+  // streaming mode state, kept between invocations of process()
+  std::string stream_key_;
+  std::vector<OGRSource> stream_sources_;
+  size_t stream_source_ = 0;
+  // whether the layer of each stream source was found
+  std::vector<bool> stream_found_;
+  OGRDatasetPtr stream_ds_;
+  OGRLayer* stream_layer_ = nullptr;
+  OGRLayerData stream_schema_;
+  OGRFeatureUniquePtr stream_pending_;
+  GIntBig stream_feature_count_ = 0;
+  GIntBig stream_features_read_ = 0;
+  size_t stream_rows_ = 0;
+
+  // keep_in_memory mode: the layers read without attribute and spatial filter,
+  // and the key of everything else they depend on
+  std::string memory_key_;
+  std::vector<OGRLayerData> memory_layers_;
+
+  bool field_selected(const std::string& name);
+  bool dictionary_field(const std::string& name);
+  std::vector<OGRSource> list_sources();
+  void check_layers_found(const std::vector<OGRSource>& sources, const std::vector<bool>& found);
+  std::unique_ptr<OGRGeometry> create_spatial_filter();
+  std::string fid_shard_filter(const OGRPooledDataset& dataset, OGRLayer* poLayer);
+  std::array<double, 4> spatial_shard_box(OGRLayer* poLayer);
+  OGRLayer* open_source(const OGRSource& source, const std::string& attribute_filter, OGRGeometry* spatial_filter, OGRDatasetPtr& dataset, OGRLayerData& data);
+  void read_source(const OGRSource& source, const std::string& attribute_filter, OGRGeometry* spatial_filter, OGRLayerData& data);
+  void read_sources(const std::vector<OGRSource>& sources, const std::string& attribute_filter, OGRGeometry* spatial_filter, const std::function<void(size_t, OGRLayerData&)>& on_layer);
+  bool push_memory_layers(const std::string& attribute_filter, OGRGeometry* spatial_filter);
+  std::string cache_file_key(const OGRSource& source);
+  std::string cache_file_path(const std::string& key);
+  bool load_cache(const std::string& key, OGRLayerData& data);
+  void save_cache(const std::string& key, const OGRLayerData& data);
+  void read_feature(OGRFeature* poFeature, OGRLayerData& data);
+  void read_features(OGRLayer* poLayer, OGRLayerData& data);
+  void read_features_parallel(OGRLayer* poLayer, OGRLayerData& data, size_t n_workers);
+  void read_arrow_stream(OGRLayer* poLayer, OGRLayerData& data);
+  void push_attributes(const OGRFeature &poFeature, OGRLayerData& data);
+  size_t read_polygon(OGRPolygon* poPolygon, OGRLayerData& data);
+  size_t add_point(const arr3d& p, OGRLayerData& data);
+  void read_mesh(OGRFeature* poFeature, OGRGeometry* poGeometry, OGRLayerData& data);
+  void push_validity(const OGRGeometry* poGeometry, bool is_polygon, OGRLayerData& data);
+  size_t read_wkb_geometry(const GByte* wkb, size_t wkb_size, OGRLayerData& data);
+  template <typename Points> void transform_fwd(const std::vector<arr3d>& points, Points& out);
+  void push_layer_data(OGRLayerData& data);
+  void push_point_attributes(OGRLayerData& data, size_t offset);
+  void reset_stream();
+  bool read_stream_batch(const std::string& attribute_filter, OGRGeometry* spatial_filter);
   
 public:
   using Node::Node;
   void init()
   {
+    add_vector_input("spatial_filter", {typeid(LinearRing)}, true);
+
     add_vector_output("line_strings", typeid(LineString));
     add_vector_output("linear_rings", typeid(LinearRing));
+    add_output("points", typeid(PointCollection));
+    add_vector_output("meshes", typeid(Mesh));
+    add_vector_output("triangle_collections", typeid(TriangleCollection));
     add_vector_output("wkt", typeid(std::string));
 
     add_vector_output("area", typeid(float));
     add_vector_output("is_valid", typeid(bool));
+    add_vector_output("feature_index", typeid(int));
+
+    add_output("end_of_stream", typeid(bool));
+    add_output("progress", typeid(float));
+    add_output("shard_feature_count", typeid(int));
 
     add_poly_output("attributes", {typeid(bool), typeid(int), typeid(float), typeid(std::string), typeid(Date), typeid(Time), typeid(DateTime)});
+    add_poly_output("attribute_dictionaries", {typeid(std::string)});
 
-    add_param(ParamPath(filepath, "filepath", "File path"));
+    add_param(ParamPath(filepath, "filepath", "File path. Multiple files can be given separated by spaces, wildcards (* and ?) in file names are expanded."));
+    add_param(ParamInt(n_threads_, "n_threads", "Maximum number of threads used to read multiple files or layers in parallel. Uses all CPU cores if set to 0."));
+    add_param(ParamInt(batch_size_, "batch_size", "Streaming mode: output at most this many features per run and continue with the next features on the following run, until end_of_stream is set. Disabled if this and batch_size_mb are 0."));
+    add_param(ParamFloat(batch_size_mb_, "batch_size_mb", "Streaming mode: approximate maximum size of a batch in megabytes. Disabled if set to 0."));
+    add_param(ParamBool(parallel_decode_, "parallel_decode", "When reading a single layer, read ahead features on one thread and decode and validate them on the other threads"));
     add_param(ParamBool(output_fid_, "output_fid", "Output attribute named 'OGR_FID' containing the OGR feature ID's"));
+    add_param(ParamBool(use_arrow_stream_, "use_arrow_stream", "Read the layer in columnar batches using the OGR Arrow stream interface. Requires GDAL 3.6 or newer, otherwise features are read one by one."));
+    add_param(ParamBool(force_optional_outputs_, "force_optional_outputs", "Compute the wkt, area and is_valid outputs even if they are not connected"));
+    add_param(ParamBoundedInt(validity_mode_, 0, 2, "validity_mode", "Validity check for the is_valid output: 0 = off, 1 = fast ring checks (vertex count, repeated vertices, zero area, holes within the exterior bbox), 2 = full GEOS check"));
     add_param(ParamFloat(base_elevation, "base_elevation", "Force the Z elevation to be this value. Ignored if set to 0."));
-    add_param(ParamString(layer_name_, "layer_name", "Layer name (takes precedence over layer ID)"));
+    add_param(ParamString(layer_name_, "layer_name", "Layer name (takes precedence over layer ID). Multiple layers can be given separated by semicolons. When the filepath matches multiple files, files that do not contain a layer are skipped, but every layer must be found in at least one file."));
     add_param(ParamInt(layer_id, "layer_id", "Layer ID"));
     add_param(ParamString(attribute_filter_, "attribute_filter", "Load only features that satisfy this condition"));
+    add_param(ParamString(fields_, "fields", "Only load these attribute fields, separated by spaces or commas. Wildcards (* and ?) can be used. Loads all fields if empty."));
+    add_param(ParamString(dictionary_fields_, "dictionary_fields", "Dictionary encode these string fields, separated by spaces or commas. Wildcards (* and ?) can be used. Their attributes are integer codes into the vector with the same name in attribute_dictionaries."));
+    add_param(ParamBool(attributes_per_feature_, "attributes_per_feature", "Output the attributes once per feature instead of once per polygon of a multipolygon. The feature_index output gives the attribute row of each polygon."));
+    add_param(ParamBool(read_meshes_, "read_meshes", "Read each (Multi)Polygon, PolyhedralSurface or TIN feature as one Mesh, with the polygon labels from the 'labels' field, as written by OGRWriter. Features that only consist of triangles are also output as TriangleCollection. The area output stays empty in this mode."));
+    add_param(ParamBool(ignore_geometry_, "ignore_geometry", "Do not read the geometries, only output the attributes (one row per feature)"));
+    add_param(ParamInt(shard_count_, "shard_count", "Split the layer in this many shards and only read shard_index. Disabled if set to 0 or 1."));
+    add_param(ParamInt(shard_index_, "shard_index", "Index of the shard to read, from 0 to shard_count - 1"));
+    add_param(ParamBool(shard_spatial_, "shard_spatial", "Split the layer in a grid of tiles over the layer extent instead of in FID ranges. A feature belongs to the tile that contains its first vertex."));
+    add_param(ParamInt(dataset_pool_size_, "dataset_pool_size", "Keep up to this many datasets open between runs, so that repeated reads do not need to open them again. Pooled files stay open (and locked on Windows) after the run. The pool is shared by all OGRLoader nodes that enable it, the largest size is used. Disabled if set to 0."));
+    add_param(ParamBool(keep_in_memory_, "keep_in_memory", "Keep the decoded layers in memory between runs. When only attribute_filter, spatial_filter_bbox or the spatial_filter input change, the filters are evaluated on the layers in memory instead of reading the files again. Filters that use a field that is not loaded or SQL that is not supported are still passed to OGR. Changes of files are detected by their modification time, changes in databases are not detected. Not used in streaming mode."));
+    add_param(ParamPath(cache_dir_, "cache_dir", "Directory for snapshots of the decoded layers. A file that has not changed since its snapshot was written is loaded from the snapshot instead of being read again. Not used in streaming mode. Disabled if empty."));
+    add_param(ParamString(spatial_filter_bbox_, "spatial_filter_bbox", "Load only features that intersect this bounding box, formatted as 'minx miny maxx maxy' in the layer CRS. Ignored when the spatial_filter input has data."));
 
     if (GDALGetDriverCount() == 0)
       GDALAllRegister();
@@ -63,6 +340,22 @@ public:
   void process();
 };
 
+/// One column of the attribute write plan of OGRWriterNode, resolved once per
+/// run instead of once per feature
+struct OGRAttributeWriter {
+  enum class Type { BOOL, FLOAT, INT, STRING, DICTIONARY, DATE, TIME, DATETIME };
+  Type type;
+  gfSingleFeatureOutputTerminal* term;
+  // OGR field index
+  int field;
+  // dictionary of a DICTIONARY attribute
+  gfSingleFeatureOutputTerminal* dictionary = nullptr;
+  // sets a value of term on a feature
+  void (*set)(OGRFeature&, const OGRAttributeWriter&, const std::any&) = nullptr;
+};
+
+struct WKBBuffer;
+
 class OGRWriterNode : public Node
 {
   std::string srs = "EPSG:7415";
@@ -77,11 +370,33 @@ class OGRWriterNode : public Node
   bool only_output_mapped_attrs_ = false;
   bool do_transactions_ = false;
   int transaction_batch_size_ = 1000;
+  int transaction_batch_mb_ = 0;
+  bool bulk_load_ = false;
+  int bulk_load_cache_mb_ = 512;
+  bool deferred_spatial_index_ = false;
+  bool pg_copy_ = false;
+  int arrow_batch_size_ = 0;
+  int n_threads_ = 1;
 
   vec1s key_options;
   StrMap output_attribute_names;
 
-  OGRPolygon create_polygon(const LinearRing& lr);
+  // guards the reverse coordinate transformation of the manager
+  std::mutex transform_mutex_;
+  // the data offset if the reverse transformation does not reproject
+  std::optional<arr3d> rev_offset_;
+
+  template <typename Points> void transform_rev(const Points& points, std::vector<arr3d>& result);
+  template <typename Points> void set_points(const Points& points, OGRSimpleCurve& curve, bool close);
+  void set_polygon(const LinearRing& lr, OGRPolygon& poly);
+  void set_polygon(const Triangle& triangle, OGRPolygon& poly);
+  template <typename Points> void append_wkb_ring(const Points& points, WKBBuffer& wkb);
+  void append_wkb(const LinearRing& lr, WKBBuffer& wkb);
+  void append_wkb(const Triangle& triangle, WKBBuffer& wkb);
+  void append_wkb(const LineString& ls, WKBBuffer& wkb);
+  template <typename Polygons> void append_wkb_multipolygon(const Polygons& polygons, WKBBuffer& wkb);
+  std::vector<OGRAttributeWriter> attribute_write_plan(const std::unordered_map<std::string, size_t>& attr_id_map, const std::unordered_map<std::string, gfSingleFeatureOutputTerminal*>& dictionaries);
+  size_t write_arrow_batches(GDALDataset* dataSource, OGRLayer* layer, const std::vector<OGRAttributeWriter>& attribute_plan, bool group_parts, bool attributes_per_feature, bool do_transactions);
 
 public:
   using Node::Node;
@@ -89,6 +404,8 @@ public:
   {
     add_vector_input("geometries", {typeid(LineString), typeid(LinearRing), typeid(std::vector<TriangleCollection>), typeid(MultiTriangleCollection), typeid(Mesh), typeid(std::unordered_map<int, Mesh>)});
     add_poly_input("attributes", {typeid(bool), typeid(int), typeid(float), typeid(std::string), typeid(Date), typeid(Time), typeid(DateTime)}, false);
+    add_poly_input("attribute_dictionaries", {typeid(std::string)}, true);
+    add_vector_input("feature_index", {typeid(int)}, true);
 
     add_param(ParamPath(conn_string_, "filepath", "Filepath or database connection string"));
     add_param(ParamText(srs, "CRS", "Coordinate reference system text. Can be EPSG code, WKT definition, etc."));
@@ -102,6 +419,13 @@ public:
     add_param(ParamBool(create_directories_, "create_directories", "Create directories to write output file"));
     add_param(ParamBool(only_output_mapped_attrs_, "only_output_mapped_attrs", "Only output those attributes selected under Output attribute names"));
     add_param(ParamBool(do_transactions_, "do_transactions", "Attempt to use OGR transactions (for large number of feature writing)"));
+    add_param(ParamInt(transaction_batch_mb_, "transaction_batch_mb", "Also commit a transaction once the written geometries take this many MB. Disabled if set to 0."));
+    add_param(ParamBool(bulk_load_, "bulk_load", "Bulk load GPKG and SQLite outputs: write in transactions, without synchronous writes and with the rollback journal in memory. The previous journal mode and synchronous setting are restored before the file is closed."));
+    add_param(ParamInt(bulk_load_cache_mb_, "bulk_load_cache_mb", "SQLite page cache size in MB during a bulk load"));
+    add_param(ParamBool(deferred_spatial_index_, "deferred_spatial_index", "Write the features without updating the spatial index, and build the index in one pass afterwards. For GPKG (R-tree) and ESRI Shapefile (.qix) outputs."));
+    add_param(ParamBool(pg_copy_, "pg_copy", "PostgreSQL: load the features with COPY into an unlogged staging table, then index it and swap it in for the layer (or append it to the layer) in one transaction. The staging table is loaded in a single transaction, transaction_batch_size_ and transaction_batch_mb do not apply."));
+    add_param(ParamInt(n_threads_, "n_threads", "Number of threads that build the features, which are then written in order by a single thread. Uses all CPU cores if set to 0."));
+    add_param(ParamInt(arrow_batch_size_, "arrow_batch_size", "Write the features in columnar batches of this many features with OGRLayer::WriteArrowBatch, for LinearRing, LineString, Mesh and TriangleCollection geometries, which are serialized straight to WKB. Other geometry types (MultiTriangleCollection, Mesh maps) are written one by one. Requires GDAL 3.8 or newer, otherwise features are written one by one. Disabled if set to 0."));
     add_param(ParamStrMap(output_attribute_names, key_options, "output_attribute_names", "Output attribute names"));
 
     if (GDALGetDriverCount() == 0)
@@ -229,12 +553,16 @@ class CSVWriterNode : public Node
   vec1s key_options;
   StrMap output_attribute_names;
 
+  // dictionaries of the dictionary encoded attributes, by attribute name
+  std::unordered_map<std::string, gfSingleFeatureOutputTerminal*> dictionaries_;
+
 public:
   using Node::Node;
   void init()
   {
     add_input("geometry", {typeid(PointCollection), typeid(SegmentCollection)});
     add_poly_input("attributes", {typeid(bool), typeid(int), typeid(float), typeid(std::string), typeid(Date), typeid(Time), typeid(DateTime)});
+    add_poly_input("attribute_dictionaries", {typeid(std::string)}, true);
 
     add_param(ParamPath(filepath, "filepath", "File path"));
     add_param(ParamBool(require_attributes_, "require_attributes", "Only run when attributes input is connected"));
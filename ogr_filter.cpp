@@ -0,0 +1,582 @@
+// This file is part of gfp-gdal
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+#include "gdal_nodes.hpp"
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <string_view>
+
+namespace geoflow::nodes::gdal
+{
+
+/// Value of an expression for one attribute row. Strings are views into the
+/// column values, the dictionaries or the literals of the expression, dates
+/// and times are compared by a key in seconds.
+struct FilterValue {
+  enum Kind { NUL, NUMBER, STRING, DATE } kind = NUL;
+  double number = 0;
+  // the number comes from a float column, compare in single precision
+  bool single = false;
+  std::string_view string;
+};
+
+inline FilterValue filter_number(double number, bool single = false) {
+  FilterValue v;
+  v.kind = FilterValue::NUMBER;
+  v.number = number;
+  v.single = single;
+  return v;
+}
+inline FilterValue filter_bool(int truth) {
+  return truth < 0 ? FilterValue() : filter_number(truth);
+}
+inline FilterValue filter_date(double key) {
+  FilterValue v;
+  v.kind = FilterValue::DATE;
+  v.number = key;
+  return v;
+}
+
+inline double date_key(const Date& d) {
+  return ((d.year * 12.0 + d.month) * 31 + d.day) * 86400;
+}
+inline double time_key(const Time& t) {
+  return t.hour * 3600.0 + t.minute * 60 + t.second;
+}
+
+/// Key of a date and/or time literal, formatted as 'YYYY-MM-DD',
+/// 'YYYY/MM/DD HH:MM:SS', 'YYYY-MM-DDTHH:MM:SS' or 'HH:MM:SS'
+inline std::optional<double> parse_date_key(std::string_view str) {
+  std::string s(str);
+  Date d{0, 0, 0};
+  Time t{0, 0, 0, 0};
+  int n = 0;
+  if (sscanf(s.c_str(), "%d%*1[-/]%d%*1[-/]%d%n", &d.year, &d.month, &d.day, &n) == 3) {
+    int m = 0;
+    if (n < int(s.size()) && (s[n] == ' ' || s[n] == 'T') &&
+        sscanf(s.c_str() + n + 1, "%d:%d:%f%n", &t.hour, &t.minute, &t.second, &m) < 2)
+      return std::nullopt;
+    return date_key(d) + time_key(t);
+  }
+  if (sscanf(s.c_str(), "%d:%d:%f", &t.hour, &t.minute, &t.second) >= 2)
+    return time_key(t);
+  return std::nullopt;
+}
+
+/// Parses a complete string as a number
+inline std::optional<double> parse_number(std::string_view str) {
+  std::string s(str);
+  char* end;
+  double v = std::strtod(s.c_str(), &end);
+  if (s.empty() || *end != '\0') return std::nullopt;
+  return v;
+}
+
+/// Compares two values, returns nothing if the result is unknown (NULL or
+/// incompatible types)
+inline std::optional<int> compare_values(const FilterValue& a, const FilterValue& b) {
+  if (a.kind == FilterValue::NUL || b.kind == FilterValue::NUL) return std::nullopt;
+  auto compare = [](double x, double y) { return x < y ? -1 : (x > y ? 1 : 0); };
+  if (a.kind == FilterValue::STRING && b.kind == FilterValue::STRING) {
+    int c = a.string.compare(b.string);
+    return c < 0 ? -1 : (c > 0 ? 1 : 0);
+  }
+  if (a.kind == b.kind) {
+    if (a.single || b.single) return compare(float(a.number), float(b.number));
+    return compare(a.number, b.number);
+  }
+  if (a.kind == FilterValue::STRING) {
+    auto c = compare_values(b, a);
+    if (c) return -*c;
+    return std::nullopt;
+  }
+  // a is a number or a date and b is a string
+  if (b.kind != FilterValue::STRING) return std::nullopt;
+  auto key = a.kind == FilterValue::DATE ? parse_date_key(b.string) : parse_number(b.string);
+  if (!key) return std::nullopt;
+  if (a.single) return compare(float(a.number), float(*key));
+  return compare(a.number, *key);
+}
+
+/// SQL LIKE with % and _ wildcards
+inline bool like_match(std::string_view str, std::string_view pattern, bool case_sensitive) {
+  auto equal = [case_sensitive](char a, char b) {
+    return case_sensitive ? a == b : std::tolower((unsigned char)a) == std::tolower((unsigned char)b);
+  };
+  size_t s = 0, p = 0;
+  // position after the last % in the pattern and the matching position in str
+  size_t star_p = std::string_view::npos, star_s = 0;
+  while (s < str.size()) {
+    if (p < pattern.size() && pattern[p] == '%') {
+      star_p = ++p;
+      star_s = s;
+    } else if (p < pattern.size() && (pattern[p] == '_' || equal(pattern[p], str[s]))) {
+      ++p;
+      ++s;
+    } else if (star_p != std::string_view::npos) {
+      p = star_p;
+      s = ++star_s;
+    } else {
+      return false;
+    }
+  }
+  while (p < pattern.size() && pattern[p] == '%') ++p;
+  return p == pattern.size();
+}
+
+struct OGRAttributeFilter::Node {
+  enum class Op { LITERAL, COLUMN, NEG, ADD, SUB, MUL, DIV, MOD, EQ, NE, LT, LE, GT, GE, AND, OR, NOT, IN, BETWEEN, LIKE, ILIKE, IS_NULL };
+  Op op;
+  // NOT IN, NOT BETWEEN, NOT LIKE and IS NOT NULL
+  bool negate = false;
+  // LIKE matches the case, set by bind from the driver of the data
+  bool case_sensitive = true;
+  // string literal or column name
+  std::string text;
+  FilterValue literal;
+  const OGRAttributeColumn* column = nullptr;
+  std::vector<std::unique_ptr<Node>> args;
+
+  explicit Node(Op op) : op(op) {}
+  FilterValue evaluate(size_t i) const;
+};
+
+/// Three-valued truth of a value: 1 true, 0 false, -1 unknown
+inline int truth(const FilterValue& v) {
+  if (v.kind == FilterValue::NUMBER) return v.number != 0;
+  return -1;
+}
+
+inline FilterValue column_value(const OGRAttributeColumn& column, size_t i) {
+  auto& value = column.values[i];
+  if (!value.has_value()) return FilterValue();
+  auto& type = value.type();
+  if (type == typeid(int)) {
+    int v = std::any_cast<int>(value);
+    if (!column.is_dictionary) return filter_number(v);
+    FilterValue s;
+    if (v < 0 || v >= int(column.dictionary.size())) return s;
+    s.kind = FilterValue::STRING;
+    s.string = column.dictionary[v];
+    return s;
+  }
+  if (type == typeid(float)) return filter_number(std::any_cast<float>(value), true);
+  if (type == typeid(bool)) return filter_number(std::any_cast<bool>(value));
+  if (type == typeid(std::string)) {
+    FilterValue s;
+    s.kind = FilterValue::STRING;
+    s.string = std::any_cast<const std::string&>(value);
+    return s;
+  }
+  if (type == typeid(Date)) return filter_date(date_key(std::any_cast<const Date&>(value)));
+  if (type == typeid(Time)) return filter_date(time_key(std::any_cast<const Time&>(value)));
+  if (type == typeid(DateTime)) {
+    auto& dt = std::any_cast<const DateTime&>(value);
+    return filter_date(date_key(dt.date) + time_key(dt.time));
+  }
+  return FilterValue();
+}
+
+FilterValue OGRAttributeFilter::Node::evaluate(size_t i) const {
+  using Op = Node::Op;
+  switch (op) {
+    case Op::LITERAL:
+      return literal;
+    case Op::COLUMN:
+      return column_value(*column, i);
+    case Op::NEG: {
+      auto v = args[0]->evaluate(i);
+      if (v.kind != FilterValue::NUMBER) return FilterValue();
+      return filter_number(-v.number, v.single);
+    }
+    case Op::ADD: case Op::SUB: case Op::MUL: case Op::DIV: case Op::MOD: {
+      auto a = args[0]->evaluate(i);
+      auto b = args[1]->evaluate(i);
+      if (a.kind != FilterValue::NUMBER || b.kind != FilterValue::NUMBER) return FilterValue();
+      bool single = a.single || b.single;
+      if (op == Op::ADD) return filter_number(a.number + b.number, single);
+      if (op == Op::SUB) return filter_number(a.number - b.number, single);
+      if (op == Op::MUL) return filter_number(a.number * b.number, single);
+      if (b.number == 0) return FilterValue();
+      if (op == Op::DIV) return filter_number(a.number / b.number, single);
+      return filter_number(std::fmod(a.number, b.number), single);
+    }
+    case Op::EQ: case Op::NE: case Op::LT: case Op::LE: case Op::GT: case Op::GE: {
+      auto c = compare_values(args[0]->evaluate(i), args[1]->evaluate(i));
+      if (!c) return FilterValue();
+      if (op == Op::EQ) return filter_bool(*c == 0);
+      if (op == Op::NE) return filter_bool(*c != 0);
+      if (op == Op::LT) return filter_bool(*c < 0);
+      if (op == Op::LE) return filter_bool(*c <= 0);
+      if (op == Op::GT) return filter_bool(*c > 0);
+      return filter_bool(*c >= 0);
+    }
+    case Op::AND: {
+      int a = truth(args[0]->evaluate(i));
+      if (a == 0) return filter_bool(0);
+      int b = truth(args[1]->evaluate(i));
+      if (b == 0) return filter_bool(0);
+      return filter_bool(a == 1 && b == 1 ? 1 : -1);
+    }
+    case Op::OR: {
+      int a = truth(args[0]->evaluate(i));
+      if (a == 1) return filter_bool(1);
+      int b = truth(args[1]->evaluate(i));
+      if (b == 1) return filter_bool(1);
+      return filter_bool(a == 0 && b == 0 ? 0 : -1);
+    }
+    case Op::NOT: {
+      int a = truth(args[0]->evaluate(i));
+      return filter_bool(a < 0 ? -1 : !a);
+    }
+    case Op::IN: {
+      auto v = args[0]->evaluate(i);
+      int result = 0;
+      for (size_t k = 1; k < args.size(); ++k) {
+        auto c = compare_values(v, args[k]->evaluate(i));
+        if (!c) result = -1;
+        else if (*c == 0) {
+          result = 1;
+          break;
+        }
+      }
+      return filter_bool(result < 0 ? -1 : result != negate);
+    }
+    case Op::BETWEEN: {
+      auto v = args[0]->evaluate(i);
+      auto lo = compare_values(v, args[1]->evaluate(i));
+      auto hi = compare_values(v, args[2]->evaluate(i));
+      if (!lo || !hi) return FilterValue();
+      return filter_bool((*lo >= 0 && *hi <= 0) != negate);
+    }
+    case Op::LIKE: case Op::ILIKE: {
+      auto v = args[0]->evaluate(i);
+      auto pattern = args[1]->evaluate(i);
+      if (v.kind != FilterValue::STRING || pattern.kind != FilterValue::STRING) return FilterValue();
+      return filter_bool(like_match(v.string, pattern.string, op == Op::LIKE && case_sensitive) != negate);
+    }
+    case Op::IS_NULL:
+      return filter_bool((args[0]->evaluate(i).kind == FilterValue::NUL) != negate);
+  }
+  return FilterValue();
+}
+
+struct FilterToken {
+  enum Type { END, NUMBER, STRING, IDENTIFIER, SYMBOL } type;
+  std::string text;
+  // double quoted identifier, never a keyword
+  bool quoted = false;
+};
+
+inline std::vector<FilterToken> tokenize_filter(const std::string& expression) {
+  std::vector<FilterToken> tokens;
+  size_t i = 0, n = expression.size();
+  auto error = [&](const std::string& message) {
+    return gfException("Cannot parse attribute_filter '" + expression + "': " + message);
+  };
+  while (i < n) {
+    char c = expression[i];
+    if (std::isspace((unsigned char)c)) {
+      ++i;
+    } else if (std::isdigit((unsigned char)c) || (c == '.' && i + 1 < n && std::isdigit((unsigned char)expression[i + 1]))) {
+      char* end;
+      std::strtod(expression.c_str() + i, &end);
+      size_t len = end - (expression.c_str() + i);
+      tokens.push_back({FilterToken::NUMBER, expression.substr(i, len)});
+      i += len;
+    } else if (c == '\'' || c == '"') {
+      // quotes are escaped by doubling them
+      std::string text;
+      ++i;
+      while (true) {
+        if (i >= n) throw(error("unterminated quote"));
+        if (expression[i] == c) {
+          if (i + 1 < n && expression[i + 1] == c) {
+            text += c;
+            i += 2;
+          } else {
+            ++i;
+            break;
+          }
+        } else {
+          text += expression[i++];
+        }
+      }
+      if (c == '\'') tokens.push_back({FilterToken::STRING, text});
+      else tokens.push_back({FilterToken::IDENTIFIER, text, true});
+    } else if (std::isalpha((unsigned char)c) || c == '_') {
+      size_t start = i;
+      while (i < n && (std::isalnum((unsigned char)expression[i]) || expression[i] == '_' || expression[i] == '.')) ++i;
+      tokens.push_back({FilterToken::IDENTIFIER, expression.substr(start, i - start)});
+    } else {
+      static const char* symbols[] = {"<>", "!=", "<=", ">=", "==", "=", "<", ">", "(", ")", ",", "+", "-", "*", "/", "%"};
+      bool found = false;
+      for (auto symbol : symbols) {
+        size_t len = strlen(symbol);
+        if (expression.compare(i, len, symbol) == 0) {
+          tokens.push_back({FilterToken::SYMBOL, symbol});
+          i += len;
+          found = true;
+          break;
+        }
+      }
+      if (!found) throw(error(std::string("unexpected character '") + c + "'"));
+    }
+  }
+  tokens.push_back({FilterToken::END, ""});
+  return tokens;
+}
+
+/// Recursive descent parser for the supported OGR SQL subset, from the lowest
+/// to the highest precedence: OR, AND, NOT, predicates, + -, * / %, unary -
+class FilterParser {
+  using Node = OGRAttributeFilter::Node;
+  using Op = Node::Op;
+  std::string expression_;
+  std::vector<FilterToken> tokens_;
+  size_t pos_ = 0;
+
+  gfException error(const std::string& message) {
+    return gfException("Cannot parse attribute_filter '" + expression_ + "': " + message);
+  }
+  const FilterToken& peek(size_t offset = 0) {
+    return tokens_[std::min(pos_ + offset, tokens_.size() - 1)];
+  }
+  bool is_keyword(const char* keyword, size_t offset = 0) {
+    auto& token = peek(offset);
+    return token.type == FilterToken::IDENTIFIER && !token.quoted && EQUAL(token.text.c_str(), keyword);
+  }
+  bool keyword(const char* keyword) {
+    if (!is_keyword(keyword)) return false;
+    ++pos_;
+    return true;
+  }
+  bool symbol(const char* symbol) {
+    auto& token = peek();
+    if (token.type != FilterToken::SYMBOL || token.text != symbol) return false;
+    ++pos_;
+    return true;
+  }
+  void expect(const char* s) {
+    if (!symbol(s)) throw(error(std::string("expected '") + s + "'"));
+  }
+  std::unique_ptr<Node> binary(Op op, std::unique_ptr<Node> a, std::unique_ptr<Node> b) {
+    auto node = std::make_unique<Node>(op);
+    node->args.push_back(std::move(a));
+    node->args.push_back(std::move(b));
+    return node;
+  }
+
+  std::unique_ptr<Node> parse_or() {
+    auto node = parse_and();
+    while (keyword("OR")) node = binary(Op::OR, std::move(node), parse_and());
+    return node;
+  }
+  std::unique_ptr<Node> parse_and() {
+    auto node = parse_not();
+    while (keyword("AND")) node = binary(Op::AND, std::move(node), parse_not());
+    return node;
+  }
+  std::unique_ptr<Node> parse_not() {
+    if (keyword("NOT")) {
+      auto node = std::make_unique<Node>(Op::NOT);
+      node->args.push_back(parse_not());
+      return node;
+    }
+    return parse_predicate();
+  }
+  std::unique_ptr<Node> parse_predicate() {
+    auto node = parse_additive();
+    static const std::pair<const char*, Op> comparisons[] = {
+      {"=", Op::EQ}, {"==", Op::EQ}, {"<>", Op::NE}, {"!=", Op::NE},
+      {"<", Op::LT}, {"<=", Op::LE}, {">", Op::GT}, {">=", Op::GE}
+    };
+    for (auto& [s, op] : comparisons) {
+      if (symbol(s)) return binary(op, std::move(node), parse_additive());
+    }
+    if (keyword("IS")) {
+      auto is_null = std::make_unique<Node>(Op::IS_NULL);
+      is_null->negate = keyword("NOT");
+      if (!keyword("NULL")) throw(error("expected NULL after IS"));
+      is_null->args.push_back(std::move(node));
+      return is_null;
+    }
+    bool negate = false;
+    if (is_keyword("NOT") && (is_keyword("IN", 1) || is_keyword("BETWEEN", 1) || is_keyword("LIKE", 1) || is_keyword("ILIKE", 1))) {
+      ++pos_;
+      negate = true;
+    }
+    if (keyword("IN")) {
+      auto in = std::make_unique<Node>(Op::IN);
+      in->negate = negate;
+      in->args.push_back(std::move(node));
+      expect("(");
+      do {
+        in->args.push_back(parse_additive());
+      } while (symbol(","));
+      expect(")");
+      return in;
+    }
+    if (keyword("BETWEEN")) {
+      auto between = std::make_unique<Node>(Op::BETWEEN);
+      between->negate = negate;
+      between->args.push_back(std::move(node));
+      between->args.push_back(parse_additive());
+      if (!keyword("AND")) throw(error("expected AND in BETWEEN"));
+      between->args.push_back(parse_additive());
+      return between;
+    }
+    if (is_keyword("LIKE") || is_keyword("ILIKE")) {
+      auto op = keyword("LIKE") ? Op::LIKE : Op::ILIKE;
+      if (op == Op::ILIKE) ++pos_;
+      auto like = binary(op, std::move(node), parse_additive());
+      like->negate = negate;
+      if (is_keyword("ESCAPE")) throw(error("LIKE ... ESCAPE is not supported"));
+      return like;
+    }
+    return node;
+  }
+  std::unique_ptr<Node> parse_additive() {
+    auto node = parse_multiplicative();
+    while (true) {
+      if (symbol("+")) node = binary(Op::ADD, std::move(node), parse_multiplicative());
+      else if (symbol("-")) node = binary(Op::SUB, std::move(node), parse_multiplicative());
+      else return node;
+    }
+  }
+  std::unique_ptr<Node> parse_multiplicative() {
+    auto node = parse_unary();
+    while (true) {
+      if (symbol("*")) node = binary(Op::MUL, std::move(node), parse_unary());
+      else if (symbol("/")) node = binary(Op::DIV, std::move(node), parse_unary());
+      else if (symbol("%")) node = binary(Op::MOD, std::move(node), parse_unary());
+      else return node;
+    }
+  }
+  std::unique_ptr<Node> parse_unary() {
+    if (symbol("-")) {
+      auto node = std::make_unique<Node>(Op::NEG);
+      node->args.push_back(parse_unary());
+      return node;
+    }
+    if (symbol("+")) return parse_unary();
+    return parse_primary();
+  }
+  std::unique_ptr<Node> parse_primary() {
+    auto& token = peek();
+    if (symbol("(")) {
+      auto node = parse_or();
+      expect(")");
+      return node;
+    }
+    auto node = std::make_unique<Node>(Op::LITERAL);
+    if (token.type == FilterToken::NUMBER) {
+      node->literal = filter_number(std::strtod(token.text.c_str(), nullptr));
+    } else if (token.type == FilterToken::STRING) {
+      node->text = token.text;
+      node->literal.kind = FilterValue::STRING;
+      node->literal.string = node->text;
+    } else if (is_keyword("NULL")) {
+      // literal stays NUL
+    } else if (is_keyword("TRUE") || is_keyword("FALSE")) {
+      node->literal = filter_number(is_keyword("TRUE"));
+    } else if (token.type == FilterToken::IDENTIFIER) {
+      if (!token.quoted && peek(1).type == FilterToken::SYMBOL && peek(1).text == "(")
+        throw(error("function " + token.text + "() is not supported"));
+      node->op = Op::COLUMN;
+      node->text = token.text;
+    } else {
+      throw(error(token.type == FilterToken::END ? "unexpected end" : "unexpected '" + token.text + "'"));
+    }
+    ++pos_;
+    return node;
+  }
+
+public:
+  explicit FilterParser(const std::string& expression)
+    : expression_(expression), tokens_(tokenize_filter(expression)) {}
+
+  std::unique_ptr<Node> parse() {
+    auto node = parse_or();
+    if (peek().type != FilterToken::END) throw(error("unexpected '" + peek().text + "'"));
+    return node;
+  }
+};
+
+OGRAttributeFilter::OGRAttributeFilter(const std::string& expression)
+  : root_(FilterParser(expression).parse()) {}
+
+OGRAttributeFilter::~OGRAttributeFilter() = default;
+
+std::vector<std::string> OGRAttributeFilter::identifiers(const std::string& expression) {
+  std::vector<std::string> result;
+  for (auto& token : tokenize_filter(expression)) {
+    if (token.type == FilterToken::IDENTIFIER) result.push_back(token.text);
+  }
+  return result;
+}
+
+/// Whether the attribute filters of a driver match LIKE case sensitively.
+/// The SQLite based drivers pass the filter to SQLite, where LIKE ignores the
+/// case of ASCII letters. PostgreSQL and OGR SQL, which the file drivers use,
+/// match the case. The other database drivers pass the filter to a server
+/// whose collation decides, which is unknown.
+inline std::optional<bool> like_case_sensitive(const std::string& driver_name) {
+  for (auto driver : {"GPKG", "SQLite"}) {
+    if (EQUAL(driver_name.c_str(), driver)) return false;
+  }
+  for (auto driver : {"MySQL", "MSSQLSpatial", "OCI", "ODBC", "PGeo", "FileGDB"}) {
+    if (EQUAL(driver_name.c_str(), driver)) return std::nullopt;
+  }
+  return true;
+}
+
+bool OGRAttributeFilter::bind(const OGRLayerData& data) {
+  std::vector<Node*> stack = {root_.get()};
+  while (!stack.empty()) {
+    auto node = stack.back();
+    stack.pop_back();
+    for (auto& arg : node->args) stack.push_back(arg.get());
+    if (node->op == Node::Op::LIKE) {
+      auto case_sensitive = like_case_sensitive(data.driver_name);
+      if (!case_sensitive) return false;
+      node->case_sensitive = *case_sensitive;
+    }
+    if (node->op != Node::Op::COLUMN) continue;
+
+    // field names are case insensitive, FID refers to the feature ID column
+    node->column = nullptr;
+    for (auto& column : data.columns) {
+      if (EQUAL(column.name.c_str(), node->text.c_str()) ||
+          (column.field_index == -1 && EQUAL(node->text.c_str(), "FID"))) {
+        node->column = &column;
+        break;
+      }
+    }
+    if (node->column == nullptr) return false;
+  }
+  return true;
+}
+
+bool OGRAttributeFilter::evaluate(size_t i) const {
+  return truth(root_->evaluate(i)) == 1;
+}
+
+} // namespace geoflow::nodes::gdal
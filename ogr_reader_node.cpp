@@ -21,291 +21,2668 @@
 #include <iomanip>
 #include <sstream>
 #include <filesystem>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <limits>
+#include <cmath>
+#include <type_traits>
+
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,6,0)
+#include <ogr_recordbatch.h>
+#endif
 
 namespace fs = std::filesystem;
 
 namespace geoflow::nodes::gdal
 {
 
-void OGRLoaderNode::push_attributes(const OGRFeature &poFeature, std::unordered_map<std::string,int>& fieldNameMap)
-{
-  for (auto &[name, mterm] : poly_output("attributes").sub_terminals())
-  {
-    //first check for null values
-    if(poFeature.IsFieldNull(fieldNameMap[name])) {
-      mterm->push_back_any(std::any());
-      continue;
-    }
-    if (mterm->accepts_type(typeid(bool)))
-    {
-      mterm->push_back(bool(poFeature.GetFieldAsInteger(name.c_str())));
+/// Minimal sequential reader for (ISO or EWKB flavoured) WKB geometries
+struct WKBCursor {
+  const GByte* ptr;
+  const GByte* end;
+  bool swap = false;
+
+  void require(size_t n) {
+    if (ptr + n > end)
+      throw(gfIOError("Truncated WKB geometry"));
+  }
+  uint32_t read_uint32() {
+    require(4);
+    uint32_t v;
+    memcpy(&v, ptr, 4);
+    ptr += 4;
+    if (swap) CPL_SWAP32PTR(&v);
+    return v;
+  }
+  double read_double() {
+    require(8);
+    double v;
+    memcpy(&v, ptr, 8);
+    ptr += 8;
+    if (swap) CPL_SWAP64PTR(&v);
+    return v;
+  }
+  // reads the byte order and geometry type of the next (sub)geometry, returns the flattened type
+  OGRwkbGeometryType read_header(bool& has_z, bool& has_m) {
+    require(1);
+    bool little_endian = *ptr++ == 1;
+    swap = little_endian != bool(CPL_IS_LSB);
+    uint32_t t = read_uint32();
+    has_z = t & 0x80000000;
+    has_m = t & 0x40000000;
+    t &= 0x0fffffff;
+    has_z = has_z || (t / 1000) == 1 || (t / 1000) == 3;
+    has_m = has_m || (t / 1000) == 2 || (t / 1000) == 3;
+    return OGRwkbGeometryType(t % 1000);
+  }
+  void read_point(arr3d& p, bool has_z, bool has_m) {
+    require((2 + has_z + has_m) * 8);
+    p[0] = read_double();
+    p[1] = read_double();
+    p[2] = has_z ? read_double() : 0;
+    if (has_m) read_double();
+  }
+  void read_points(std::vector<arr3d>& points, bool has_z, bool has_m) {
+    auto n = read_uint32();
+    require(size_t(n) * (2 + has_z + has_m) * 8);
+    points.resize(n);
+    for (auto& p : points) {
+      p[0] = read_double();
+      p[1] = read_double();
+      p[2] = has_z ? read_double() : 0;
+      if (has_m) read_double();
+    }
+  }
+};
+
+/// Twice the signed area of a closed ring in the xy-plane, positive for CCW rings
+inline double signed_area2(const std::vector<arr3d>& ring) {
+  double a = 0;
+  for (size_t i = 0; i + 1 < ring.size(); ++i) {
+    a += ring[i][0] * ring[i+1][1] - ring[i+1][0] * ring[i][1];
+  }
+  return a;
+}
+
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,6,0)
+/// Releases an Arrow C data interface object (schema, array or stream) when going out of scope
+template <typename T> struct ArrowReleaser {
+  T obj{};
+  ~ArrowReleaser() {
+    if (obj.release) obj.release(&obj);
+  }
+};
+
+inline bool arrow_is_valid(const ArrowArray* array, int64_t i) {
+  auto bitmap = static_cast<const uint8_t*>(array->buffers[0]);
+  if (array->null_count == 0 || bitmap == nullptr) return true;
+  i += array->offset;
+  return (bitmap[i >> 3] >> (i & 7)) & 1;
+}
+
+inline int64_t arrow_get_int(const ArrowArray* array, char format, int64_t i) {
+  i += array->offset;
+  switch (format) {
+    case 'c': return static_cast<const int8_t*>(array->buffers[1])[i];
+    case 'C': return static_cast<const uint8_t*>(array->buffers[1])[i];
+    case 's': return static_cast<const int16_t*>(array->buffers[1])[i];
+    case 'S': return static_cast<const uint16_t*>(array->buffers[1])[i];
+    case 'i': return static_cast<const int32_t*>(array->buffers[1])[i];
+    case 'I': return static_cast<const uint32_t*>(array->buffers[1])[i];
+    case 'l': return static_cast<const int64_t*>(array->buffers[1])[i];
+    case 'L': return int64_t(static_cast<const uint64_t*>(array->buffers[1])[i]);
+    case 'b': return (static_cast<const uint8_t*>(array->buffers[1])[i >> 3] >> (i & 7)) & 1;
+  }
+  return 0;
+}
+
+/// Get a pointer to the bytes of a (large) binary or (large) utf8 array element
+inline const char* arrow_get_bytes(const ArrowArray* array, bool large, int64_t i, size_t& size) {
+  i += array->offset;
+  auto data = static_cast<const char*>(array->buffers[2]);
+  if (large) {
+    auto offsets = static_cast<const int64_t*>(array->buffers[1]);
+    size = size_t(offsets[i+1] - offsets[i]);
+    return data + offsets[i];
+  } else {
+    auto offsets = static_cast<const int32_t*>(array->buffers[1]);
+    size = size_t(offsets[i+1] - offsets[i]);
+    return data + offsets[i];
+  }
+}
+
+/// Convert days since 1970-01-01 to a civil date (proleptic Gregorian calendar)
+inline Date date_from_days(int64_t z) {
+  z += 719468;
+  const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  const int64_t doe = z - era * 146097;
+  const int64_t yoe = (doe - doe/1460 + doe/36524 - doe/146096) / 365;
+  const int64_t doy = doe - (365*yoe + yoe/4 - yoe/100);
+  const int64_t mp = (5*doy + 2) / 153;
+  Date date;
+  date.day = int(doy - (153*mp + 2)/5 + 1);
+  date.month = int(mp < 10 ? mp + 3 : mp - 9);
+  date.year = int(yoe + era * 400 + (date.month <= 2));
+  return date;
+}
+
+/// Convert an Arrow timezone string to an OGR TZFlag and an offset in seconds
+inline int tzflag_from_arrow(const std::string& tz, int64_t& offset_s) {
+  offset_s = 0;
+  if (tz.empty()) return 0;
+  if (tz == "UTC" || tz == "Etc/UTC" || tz == "Z") return 100;
+  if (tz.size() == 6 && (tz[0] == '+' || tz[0] == '-') && tz[3] == ':') {
+    int minutes = std::stoi(tz.substr(1, 2)) * 60 + std::stoi(tz.substr(4, 2));
+    if (tz[0] == '-') minutes = -minutes;
+    offset_s = int64_t(minutes) * 60;
+    return 100 + minutes / 15;
+  }
+  return 0;
+}
+
+/// Decode a single value from an Arrow array to the given geoflow attribute type
+inline std::any arrow_get_value(const ArrowArray* array, const std::string& format, int64_t i, std::type_index type) {
+  if (!arrow_is_valid(array, i)) return std::any();
+
+  if (format.size() == 1 && std::strchr("cCsSiIlLb", format[0])) {
+    auto v = arrow_get_int(array, format[0], i);
+    if (type == typeid(bool)) return bool(v);
+    else if (type == typeid(int)) return int(v);
+    else if (type == typeid(float)) return float(v);
+  } else if (format == "f" || format == "g") {
+    double v = format == "f" ? static_cast<const float*>(array->buffers[1])[i + array->offset]
+                             : static_cast<const double*>(array->buffers[1])[i + array->offset];
+    if (type == typeid(float)) return float(v);
+    else if (type == typeid(int)) return int(v);
+  } else if (format == "u" || format == "U") {
+    size_t size;
+    auto str = arrow_get_bytes(array, format == "U", i, size);
+    if (type == typeid(std::string)) return std::string(str, size);
+  } else if (format == "tdD" || format == "tdm") {
+    auto days = format == "tdD" ? int64_t(static_cast<const int32_t*>(array->buffers[1])[i + array->offset])
+                                : static_cast<const int64_t*>(array->buffers[1])[i + array->offset] / 86400000;
+    if (type == typeid(Date)) return date_from_days(days);
+  } else if (format.size() == 3 && format.compare(0, 2, "tt") == 0) {
+    // time of day, 32 bit for second and millisecond units, 64 bit otherwise
+    double s;
+    switch (format[2]) {
+      case 's': s = static_cast<const int32_t*>(array->buffers[1])[i + array->offset]; break;
+      case 'm': s = static_cast<const int32_t*>(array->buffers[1])[i + array->offset] / 1e3; break;
+      case 'u': s = static_cast<const int64_t*>(array->buffers[1])[i + array->offset] / 1e6; break;
+      default:  s = static_cast<const int64_t*>(array->buffers[1])[i + array->offset] / 1e9; break;
+    }
+    Time time;
+    time.hour = int(s / 3600);
+    time.minute = int(s / 60) % 60;
+    time.second = float(s - time.hour * 3600 - time.minute * 60);
+    time.timeZone = 0;
+    if (type == typeid(Time)) return time;
+  } else if (format.size() >= 4 && format.compare(0, 2, "ts") == 0 && format[3] == ':') {
+    int64_t v = static_cast<const int64_t*>(array->buffers[1])[i + array->offset];
+    int64_t units_per_s = format[2] == 's' ? 1 : format[2] == 'm' ? 1000 : format[2] == 'u' ? 1000000 : 1000000000;
+    int64_t offset_s;
+    DateTime t;
+    t.time.timeZone = tzflag_from_arrow(format.substr(4), offset_s);
+    // floor division so that timestamps before the epoch map to the right day
+    int64_t secs = v / units_per_s - (v % units_per_s < 0);
+    double frac = double(v - secs * units_per_s) / units_per_s;
+    secs += offset_s;
+    int64_t days = secs / 86400 - (secs % 86400 < 0);
+    int64_t sod = secs - days * 86400;
+    t.date = date_from_days(days);
+    t.time.hour = int(sod / 3600);
+    t.time.minute = int(sod / 60) % 60;
+    t.time.second = float(sod % 60 + frac);
+    if (type == typeid(DateTime)) return t;
+    else if (type == typeid(Date)) return t.date;
+  }
+  return std::any();
+}
+#endif
+
+/// Convert an attribute value to another geoflow attribute type, used when
+/// sources disagree on the type of a field. Returns an empty value when there
+/// is no sensible conversion.
+inline std::any convert_attribute(const std::any& value, std::type_index type) {
+  if (!value.has_value() || std::type_index(value.type()) == type) return value;
+
+  double v;
+  if (value.type() == typeid(bool)) v = std::any_cast<bool>(value);
+  else if (value.type() == typeid(int)) v = std::any_cast<int>(value);
+  else if (value.type() == typeid(float)) v = std::any_cast<float>(value);
+  else if (value.type() == typeid(DateTime) && type == typeid(Date)) return std::any_cast<DateTime>(value).date;
+  else if (type == typeid(std::string)) {
+    // ISO 8601 text for dates and times
+    char buf[32];
+    if (value.type() == typeid(Date)) {
+      auto& d = std::any_cast<const Date&>(value);
+      snprintf(buf, sizeof(buf), "%04d-%02d-%02d", d.year, d.month, d.day);
+    } else if (value.type() == typeid(Time)) {
+      auto& t = std::any_cast<const Time&>(value);
+      snprintf(buf, sizeof(buf), "%02d:%02d:%06.3f", t.hour, t.minute, t.second);
+    } else if (value.type() == typeid(DateTime)) {
+      auto& dt = std::any_cast<const DateTime&>(value);
+      snprintf(buf, sizeof(buf), "%04d-%02d-%02dT%02d:%02d:%06.3f", dt.date.year, dt.date.month, dt.date.day, dt.time.hour, dt.time.minute, dt.time.second);
+    } else {
+      return std::any();
+    }
+    return std::string(buf);
+  }
+  else return std::any();
+
+  if (type == typeid(bool)) return bool(v);
+  else if (type == typeid(int)) return int(v);
+  else if (type == typeid(float)) return float(v);
+  else if (type == typeid(std::string)) {
+    std::ostringstream ss;
+    ss << v;
+    return ss.str();
+  }
+  return std::any();
+}
+
+inline bool is_connected(gfSingleFeatureOutputTerminal& term) {
+  return !term.get_connections().empty();
+}
+
+/// Match a file name against a pattern with * and ? wildcards
+inline bool wildcard_match(const char* pattern, const char* str) {
+  if (*pattern == '\0') return *str == '\0';
+  if (*pattern == '*') {
+    return wildcard_match(pattern + 1, str) || (*str != '\0' && wildcard_match(pattern, str + 1));
+  }
+  if (*str != '\0' && (*pattern == '?' || *pattern == *str)) {
+    return wildcard_match(pattern + 1, str + 1);
+  }
+  return false;
+}
+
+/// Split a space separated list of paths and expand wildcards in the file names
+inline std::vector<std::string> expand_filepaths(const std::string& filepaths) {
+  // database connection strings and existing paths that contain spaces are used as is
+  if (filepaths.find(' ') == std::string::npos || filepaths.rfind("PG:", 0) == 0 || fs::exists(filepaths)) {
+    return {filepaths};
+  }
+  std::vector<std::string> result;
+  for (auto& path : split_string(filepaths, " ")) {
+    if (path.empty()) continue;
+    auto fname = fs::path(path).filename().string();
+    if (fname.find_first_of("*?") == std::string::npos) {
+      result.push_back(path);
+      continue;
+    }
+    auto dir = fs::path(path).parent_path();
+    std::vector<std::string> matches;
+    std::error_code ec;
+    for (auto& entry : fs::directory_iterator(dir.empty() ? fs::path(".") : dir, ec)) {
+      if (wildcard_match(fname.c_str(), entry.path().filename().string().c_str())) {
+        matches.push_back(entry.path().string());
+      }
+    }
+    if (matches.empty()) {
+      std::cout << "No files found matching " << path << "\n";
+    }
+    std::sort(matches.begin(), matches.end());
+    result.insert(result.end(), matches.begin(), matches.end());
+  }
+  return result;
+}
+
+// Field decoders, these read the raw OGRField directly. The field type is
+// checked once per layer when the decode plan (OGRLayerData::columns) is set up.
+inline void decode_bool(const OGRFeature& f, OGRAttributeColumn& c) {
+  c.values.push_back(bool(f.GetRawFieldRef(c.field_index)->Integer));
+}
+inline void decode_int(const OGRFeature& f, OGRAttributeColumn& c) {
+  c.values.push_back(int(f.GetRawFieldRef(c.field_index)->Integer));
+}
+inline void decode_int64(const OGRFeature& f, OGRAttributeColumn& c) {
+  c.values.push_back(int(f.GetRawFieldRef(c.field_index)->Integer64));
+}
+inline void decode_real(const OGRFeature& f, OGRAttributeColumn& c) {
+  c.values.push_back(float(f.GetRawFieldRef(c.field_index)->Real));
+}
+inline void decode_string(const OGRFeature& f, OGRAttributeColumn& c) {
+  c.values.push_back(std::string(f.GetRawFieldRef(c.field_index)->String));
+}
+/// Code of a string in the dictionary of a column, new strings are appended
+inline int intern_string(OGRAttributeColumn& c, std::string str) {
+  auto it = c.dictionary_codes.find(str);
+  if (it != c.dictionary_codes.end()) return it->second;
+  int code = int(c.dictionary.size());
+  c.dictionary.push_back(str);
+  c.dictionary_codes.emplace(std::move(str), code);
+  return code;
+}
+inline void decode_string_code(const OGRFeature& f, OGRAttributeColumn& c) {
+  c.values.push_back(intern_string(c, f.GetRawFieldRef(c.field_index)->String));
+}
+inline void decode_date(const OGRFeature& f, OGRAttributeColumn& c) {
+  auto& d = f.GetRawFieldRef(c.field_index)->Date;
+  Date date;
+  date.year = d.Year;
+  date.month = d.Month;
+  date.day = d.Day;
+  c.values.push_back(date);
+}
+inline void decode_time(const OGRFeature& f, OGRAttributeColumn& c) {
+  auto& d = f.GetRawFieldRef(c.field_index)->Date;
+  Time time;
+  time.hour = d.Hour;
+  time.minute = d.Minute;
+  time.second = d.Second;
+  time.timeZone = d.TZFlag;
+  c.values.push_back(time);
+}
+inline void decode_datetime(const OGRFeature& f, OGRAttributeColumn& c) {
+  auto& d = f.GetRawFieldRef(c.field_index)->Date;
+  DateTime t;
+  t.date.year = d.Year;
+  t.date.month = d.Month;
+  t.date.day = d.Day;
+  t.time.hour = d.Hour;
+  t.time.minute = d.Minute;
+  t.time.second = d.Second;
+  t.time.timeZone = d.TZFlag;
+  c.values.push_back(t);
+}
+inline void decode_fid(const OGRFeature& f, OGRAttributeColumn& c) {
+  c.values.push_back(int(f.GetFID()));
+}
+
+/// Reserve space for the expected number of features
+inline void reserve_layer_data(OGRLayerData& data, GIntBig n) {
+  if (n <= 0) return;
+  data.wkt.reserve(n);
+  data.area.reserve(n);
+  data.is_valid.reserve(n);
+  data.feature_index.reserve(n);
+  for (auto& column : data.columns) column.values.reserve(n);
+}
+
+void OGRLoaderNode::push_attributes(const OGRFeature &poFeature, OGRLayerData& data)
+{
+  for (auto& column : data.columns)
+  {
+    // unset and null fields become empty values
+    if (column.field_index != -1 && !poFeature.IsFieldSetAndNotNull(column.field_index)) {
+      column.values.emplace_back();
+      continue;
+    }
+    column.decode(poFeature, column);
+  }
+}
+
+/// Cheap validity check of a ring without closing point: at least 3 vertices,
+/// no repeated consecutive vertices and a non-zero area. Self-intersections
+/// are not detected.
+inline bool ring_is_valid_fast(const std::vector<arr3d>& ring) {
+  if (ring.size() < 3) return false;
+  double a = 0;
+  for (size_t i = 0; i < ring.size(); ++i) {
+    auto& p = ring[i];
+    auto& q = ring[(i + 1) % ring.size()];
+    if (p[0] == q[0] && p[1] == q[1]) return false;
+    a += p[0] * q[1] - q[0] * p[1];
+  }
+  return a != 0;
+}
+
+/// Cheap validity check of a polygon: all rings pass ring_is_valid_fast() and
+/// the interior rings lie within the bounding box of the exterior ring
+inline bool polygon_is_valid_fast(const std::vector<std::vector<arr3d>>& polygon) {
+  if (polygon.empty()) return false;
+  OGREnvelope exterior_env;
+  for (size_t r = 0; r < polygon.size(); ++r) {
+    if (!ring_is_valid_fast(polygon[r])) return false;
+    for (auto& p : polygon[r]) {
+      if (r == 0) {
+        exterior_env.Merge(p[0], p[1]);
+      } else if (p[0] < exterior_env.MinX || p[0] > exterior_env.MaxX || p[1] < exterior_env.MinY || p[1] > exterior_env.MaxY) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+inline bool line_string_is_valid_fast(const std::vector<arr3d>& line_string) {
+  for (size_t i = 1; i < line_string.size(); ++i) {
+    if (line_string[i][0] != line_string[0][0] || line_string[i][1] != line_string[0][1]) return true;
+  }
+  return false;
+}
+
+/// Copy the vertices of an OGR curve into a contiguous xyz array in one call,
+/// Z is set to 0 for 2D curves
+inline void get_points(const OGRSimpleCurve* curve, std::vector<arr3d>& points) {
+  points.resize(curve->getNumPoints());
+  if (points.empty()) return;
+  curve->getPoints(&points[0][0], sizeof(arr3d), &points[0][1], sizeof(arr3d), &points[0][2], sizeof(arr3d));
+}
+
+/// Fix the ring orientation (ccw exterior, cw interior), drop the closing
+/// points and store the polygon. Returns the number of polygons added, a
+/// polygon without a valid exterior ring is counted in n_degenerate instead.
+inline size_t add_polygon(std::vector<std::vector<arr3d>>& rings, OGRLayerData& data, bool store_area) {
+  if (rings.empty() || rings[0].size() < 4) {
+    ++data.n_degenerate;
+    return 0;
+  }
+
+  std::vector<std::vector<arr3d>> polygon;
+  polygon.reserve(rings.size());
+  double area2 = 0;
+  for (size_t r = 0; r < rings.size(); ++r) {
+    auto& ring = rings[r];
+    if (ring.size() < 4) continue;
+    double a = signed_area2(ring);
+    if ((r == 0 && a < 0) || (r > 0 && a > 0)) {
+      std::reverse(ring.begin(), ring.end());
+    }
+    area2 += r == 0 ? std::abs(a) : -std::abs(a);
+    ring.pop_back();
+    polygon.push_back(std::move(ring));
+  }
+  data.polygons.push_back(std::move(polygon));
+  if (store_area)
+    data.area.push_back(float(area2 / 2));
+  return 1;
+}
+
+/// Add a point, empty points (NaN coordinates in WKB) are skipped. Returns the
+/// number of points added.
+size_t OGRLoaderNode::add_point(const arr3d& p, OGRLayerData& data) {
+  if (std::isnan(p[0]) || std::isnan(p[1])) return 0;
+  data.points.push_back(p);
+  // a point is always valid
+  if (validity_check_ != ValidityCheck::OFF)
+    data.is_valid.push_back(true);
+  return 1;
+}
+
+void OGRLoaderNode::push_validity(const OGRGeometry* poGeometry, bool is_polygon, OGRLayerData& data) {
+  if (validity_check_ == ValidityCheck::FAST) {
+    data.is_valid.push_back(is_polygon ? polygon_is_valid_fast(data.polygons.back()) : line_string_is_valid_fast(data.line_strings.back()));
+  } else if (validity_check_ == ValidityCheck::GEOS) {
+    data.is_valid.push_back(bool(poGeometry->IsValid()));
+  }
+}
+
+size_t OGRLoaderNode::read_polygon(OGRPolygon* poPolygon, OGRLayerData& data) {
+  std::vector<std::vector<arr3d>> rings(1 + poPolygon->getNumInteriorRings());
+  for (size_t r = 0; r < rings.size(); ++r) {
+    auto ogr_ring = r == 0 ? poPolygon->getExteriorRing() : poPolygon->getInteriorRing(r - 1);
+    if (ogr_ring == nullptr) continue;
+    get_points(ogr_ring, rings[r]);
+  }
+  return add_polygon(rings, data, compute_area_);
+}
+
+void OGRLoaderNode::read_mesh(OGRFeature* poFeature, OGRGeometry* poGeometry, OGRLayerData& data) {
+  std::vector<OGRPolygon*> parts;
+  auto type = wkbFlatten(poGeometry->getGeometryType());
+  if (type == wkbPolygon) {
+    parts.push_back(poGeometry->toPolygon());
+  } else if (type == wkbMultiPolygon) {
+    for (auto poPolygon : *poGeometry->toMultiPolygon()) parts.push_back(poPolygon);
+  } else {
+    // PolyhedralSurface and TIN
+    auto poSurface = poGeometry->toPolyhedralSurface();
+    for (int k = 0; k < poSurface->getNumGeometries(); ++k) parts.push_back(poSurface->getGeometryRef(k));
+  }
+
+  // the ring orientation is kept as it is, it determines the face normals
+  data.meshes.emplace_back();
+  auto& mesh = data.meshes.back();
+  for (auto poPolygon : parts) {
+    std::vector<std::vector<arr3d>> rings;
+    for (int r = 0; r < 1 + poPolygon->getNumInteriorRings(); ++r) {
+      auto ogr_ring = r == 0 ? poPolygon->getExteriorRing() : poPolygon->getInteriorRing(r - 1);
+      if (ogr_ring == nullptr) continue;
+      rings.emplace_back();
+      get_points(ogr_ring, rings.back());
+      if (rings.back().size() > 1 && rings.back().front() == rings.back().back())
+        rings.back().pop_back();
+    }
+    if (rings.size() && rings[0].size() >= 3) mesh.push_back(std::move(rings));
+  }
+
+  // the semantic labels of the polygons, as written by OGRWriter
+  data.mesh_labels.emplace_back();
+  if (data.labels_field != -1 && poFeature->IsFieldSetAndNotNull(data.labels_field)) {
+    int n;
+    auto labels = poFeature->GetFieldAsIntegerList(data.labels_field, &n);
+    if (size_t(n) == mesh.size()) data.mesh_labels.back().assign(labels, labels + n);
+  }
+
+  if (validity_check_ == ValidityCheck::FAST) {
+    bool valid = !mesh.empty();
+    for (auto& polygon : mesh) valid = valid && polygon_is_valid_fast(polygon);
+    data.is_valid.push_back(valid);
+  } else if (validity_check_ == ValidityCheck::GEOS) {
+    data.is_valid.push_back(bool(poGeometry->IsValid()));
+  }
+  data.feature_index.push_back(int(data.n_features++));
+  push_attributes(*poFeature, data);
+}
+
+size_t OGRLoaderNode::read_wkb_geometry(const GByte* wkb, size_t wkb_size, OGRLayerData& data)
+{
+  // only the wkt output and the GEOS validity check need an OGR geometry object
+  OGRGeometry* poGeometry = nullptr;
+  if (compute_wkt_ || validity_check_ == ValidityCheck::GEOS) {
+    if (OGRGeometryFactory::createFromWkb(wkb, nullptr, &poGeometry, wkb_size) != OGRERR_NONE)
+      throw(gfIOError("Unable to parse WKB geometry"));
+  }
+  std::unique_ptr<OGRGeometry> geometry_ptr(poGeometry);
+
+  WKBCursor cursor{wkb, wkb + wkb_size};
+  bool has_z, has_m;
+  auto type = cursor.read_header(has_z, has_m);
+  std::vector<std::vector<arr3d>> rings;
+  size_t n_pushed = 0;
+  if (type == wkbLineString) {
+    data.line_strings.emplace_back();
+    cursor.read_points(data.line_strings.back(), has_z, has_m);
+    push_validity(poGeometry, false, data);
+    n_pushed = 1;
+  } else if (type == wkbPolygon) {
+    rings.resize(cursor.read_uint32());
+    for (auto& ring : rings) cursor.read_points(ring, has_z, has_m);
+    if ((n_pushed = add_polygon(rings, data, compute_area_))) {
+      push_validity(poGeometry, true, data);
+    }
+  } else if (type == wkbPoint) {
+    arr3d p;
+    cursor.read_point(p, has_z, has_m);
+    n_pushed = add_point(p, data);
+  } else if (type == wkbMultiPoint) {
+    auto n_parts = cursor.read_uint32();
+    for (uint32_t k = 0; k < n_parts; ++k) {
+      arr3d p;
+      cursor.read_header(has_z, has_m);
+      cursor.read_point(p, has_z, has_m);
+      n_pushed += add_point(p, data);
+    }
+  } else if (type == wkbMultiPolygon) {
+    auto poMultiPolygon = poGeometry ? poGeometry->toMultiPolygon() : nullptr;
+    auto n_parts = cursor.read_uint32();
+    for (uint32_t k = 0; k < n_parts; ++k) {
+      cursor.read_header(has_z, has_m);
+      rings.resize(cursor.read_uint32());
+      for (auto& ring : rings) cursor.read_points(ring, has_z, has_m);
+      if (add_polygon(rings, data, compute_area_)) {
+        push_validity(poMultiPolygon ? poMultiPolygon->getGeometryRef(k) : nullptr, true, data);
+        ++n_pushed;
+      }
+    }
+  } else {
+    throw gfIOError("Unsupported geometry type\n");
+  }
+  // no wkt for features that were skipped, it stays aligned with the features
+  if (compute_wkt_ && n_pushed)
+    data.wkt.push_back(poGeometry->exportToWkt());
+  return n_pushed;
+}
+
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,6,0)
+void OGRLoaderNode::read_arrow_stream(OGRLayer* poLayer, OGRLayerData& data)
+{
+  ArrowReleaser<ArrowArrayStream> stream;
+  char** options = nullptr;
+  options = CSLSetNameValue(options, "INCLUDE_FID", output_fid_ ? "YES" : "NO");
+  bool stream_ok = poLayer->GetArrowStream(&stream.obj, options);
+  CSLDestroy(options);
+  if (!stream_ok)
+    throw(gfIOError("Unable to open Arrow stream on layer " + std::string(poLayer->GetName())));
+
+  ArrowReleaser<ArrowSchema> schema;
+  if (stream.obj.get_schema(&stream.obj, &schema.obj) != 0)
+    throw(gfIOError("Unable to get Arrow schema of layer " + std::string(poLayer->GetName())));
+
+  std::string geom_column = poLayer->GetGeometryColumn();
+  if (geom_column.empty()) geom_column = "wkb_geometry";
+  std::string fid_column = poLayer->GetFIDColumn();
+  if (fid_column.empty()) fid_column = "OGC_FID";
+
+  // map the arrow columns to the attribute columns
+  struct ArrowColumn {
+    int64_t index;
+    std::string format;
+    OGRAttributeColumn* column;
+  };
+  std::vector<ArrowColumn> arrow_columns;
+  std::vector<OGRAttributeColumn*> unmapped_columns;
+  int64_t geom_index = -1;
+  std::string geom_format;
+  for (auto& column : data.columns) {
+    bool mapped = false;
+    for (int64_t c = 0; c < schema.obj.n_children; ++c) {
+      auto child = schema.obj.children[c];
+      std::string child_name = child->name;
+      if (child_name == column.name || (column.field_index == -1 && child_name == fid_column)) {
+        arrow_columns.push_back({c, child->format, &column});
+        mapped = true;
+        break;
+      }
+    }
+    if (!mapped) unmapped_columns.push_back(&column);
+  }
+  // the geometry is still in the stream when a spatial filter is set
+  for (int64_t c = 0; c < schema.obj.n_children && !ignore_geometry_; ++c) {
+    if (geom_column == schema.obj.children[c]->name) {
+      geom_index = c;
+      geom_format = schema.obj.children[c]->format;
+    }
+  }
+  if (geom_index < 0 && !ignore_geometry_)
+    throw(gfIOError("No geometry column found in Arrow stream of layer " + std::string(poLayer->GetName())));
+  if (geom_index >= 0 && geom_format != "z" && geom_format != "Z")
+    throw(gfIOError("Unexpected Arrow geometry column format " + geom_format));
+
+  std::vector<size_t> n_parts;
+  while (true) {
+    ArrowReleaser<ArrowArray> batch;
+    if (stream.obj.get_next(&stream.obj, &batch.obj) != 0) {
+      auto err = stream.obj.get_last_error(&stream.obj);
+      throw(gfIOError("Reading Arrow batch failed: " + std::string(err ? err : "")));
+    }
+    // end of stream
+    if (batch.obj.release == nullptr) break;
+
+    // decode the geometries, remembering how many geoflow geometries each row produced
+    if (geom_index < 0) {
+      // attribute only mode, one attribute row per feature
+      n_parts.assign(batch.obj.length, 1);
+    } else {
+      n_parts.assign(batch.obj.length, 0);
+    }
+    auto geom_array = geom_index < 0 ? nullptr : batch.obj.children[geom_index];
+    for (int64_t r = 0; geom_array && r < batch.obj.length; ++r) {
+      if (!arrow_is_valid(geom_array, r)) continue;
+      size_t wkb_size;
+      auto wkb = reinterpret_cast<const GByte*>(arrow_get_bytes(geom_array, geom_format == "Z", r, wkb_size));
+      n_parts[r] = read_wkb_geometry(wkb, wkb_size, data);
+    }
+    for (int64_t r = 0; r < batch.obj.length; ++r) {
+      if (n_parts[r] == 0) continue;
+      if (geom_array) data.feature_index.insert(data.feature_index.end(), n_parts[r], int(data.n_features));
+      ++data.n_features;
+      // attribute rows of this feature
+      if (attributes_per_feature_) n_parts[r] = 1;
+    }
+
+    // fill the attribute columns
+    for (auto& arrow_column : arrow_columns) {
+      auto array = batch.obj.children[arrow_column.index];
+      auto& column = *arrow_column.column;
+      bool codes = column.is_dictionary && (arrow_column.format == "u" || arrow_column.format == "U");
+      for (int64_t r = 0; r < batch.obj.length; ++r) {
+        if (n_parts[r] == 0) continue;
+        std::any value;
+        if (codes) {
+          if (arrow_is_valid(array, r)) {
+            size_t size;
+            auto str = arrow_get_bytes(array, arrow_column.format == "U", r, size);
+            value = intern_string(column, std::string(str, size));
+          }
+        } else {
+          value = arrow_get_value(array, arrow_column.format, r, column.type);
+        }
+        column.values.insert(column.values.end(), n_parts[r], value);
+      }
+    }
+    for (auto column : unmapped_columns) {
+      for (int64_t r = 0; r < batch.obj.length; ++r) {
+        column->values.insert(column->values.end(), n_parts[r], std::any());
+      }
+    }
+  }
+}
+#endif
+
+void OGRLoaderNode::read_feature(OGRFeature* poFeature, OGRLayerData& data)
+{
+  // read feature geometry
+  OGRGeometry *poGeometry;
+  
+  // the geometry is still fetched when a spatial filter is set
+  poGeometry = ignore_geometry_ ? nullptr : poFeature->GetGeometryRef();
+  if (poGeometry != nullptr) // FIXME: we should check if te layer geometrytype matches with this feature's geometry type. Messy because they can be a bit different eg. wkbLineStringZM and wkbLineString25D
+  {
+    size_t n_features = data.n_features;
+    auto type = wkbFlatten(poGeometry->getGeometryType());
+    if (read_meshes_ && (type == wkbPolygon || type == wkbMultiPolygon || type == wkbPolyhedralSurface || type == wkbTIN))
+    {
+      read_mesh(poFeature, poGeometry, data);
+    }
+    else if (wkbFlatten(poGeometry->getGeometryType()) == wkbLineString)
+    {
+      OGRLineString *poLineString = poGeometry->toLineString();
+
+      data.line_strings.emplace_back();
+      get_points(poLineString, data.line_strings.back());
+      push_validity(poGeometry, false, data);
+      data.feature_index.push_back(int(data.n_features++));
+
+      push_attributes(*poFeature, data);
+    }
+    else if (wkbFlatten(poGeometry->getGeometryType()) == wkbPolygon)
+    {
+      OGRPolygon *poPolygon = poGeometry->toPolygon();
+
+      if (read_polygon(poPolygon, data)) {
+        push_validity(poPolygon, true, data);
+        data.feature_index.push_back(int(data.n_features++));
+
+        push_attributes(*poFeature, data);
+      }
+    } 
+    else if ( wkbFlatten(poGeometry->getGeometryType()) == wkbMultiPolygon ) 
+    {
+      OGRMultiPolygon *poMultiPolygon = poGeometry->toMultiPolygon();
+      size_t n_parts = 0;
+      for (auto poly_it = poMultiPolygon->begin(); poly_it != poMultiPolygon->end(); ++poly_it) {
+        if (read_polygon(*poly_it, data)) {
+          push_validity(*poly_it, true, data);
+          data.feature_index.push_back(int(data.n_features));
+
+          if (!attributes_per_feature_ || n_parts == 0)
+            push_attributes(*poFeature, data);
+          ++n_parts;
+        }
+      }
+      if (n_parts) ++data.n_features;
+    }
+    else if (wkbFlatten(poGeometry->getGeometryType()) == wkbPoint)
+    {
+      OGRPoint *poPoint = poGeometry->toPoint();
+      if (!poPoint->IsEmpty() && add_point({poPoint->getX(), poPoint->getY(), poPoint->getZ()}, data)) {
+        data.feature_index.push_back(int(data.n_features++));
+
+        push_attributes(*poFeature, data);
+      }
+    }
+    else if (wkbFlatten(poGeometry->getGeometryType()) == wkbMultiPoint)
+    {
+      OGRMultiPoint *poMultiPoint = poGeometry->toMultiPoint();
+      size_t n_parts = 0;
+      for (auto point_it = poMultiPoint->begin(); point_it != poMultiPoint->end(); ++point_it) {
+        auto poPoint = *point_it;
+        if (!poPoint->IsEmpty() && add_point({poPoint->getX(), poPoint->getY(), poPoint->getZ()}, data)) {
+          data.feature_index.push_back(int(data.n_features));
+
+          if (!attributes_per_feature_ || n_parts == 0)
+            push_attributes(*poFeature, data);
+          ++n_parts;
+        }
+      }
+      if (n_parts) ++data.n_features;
+    } else {
+      throw gfIOError("Unsupported geometry type\n");
+    }
+    // no wkt for features that were skipped, it stays aligned with the features
+    if (compute_wkt_ && data.n_features > n_features)
+      data.wkt.push_back(poGeometry->exportToWkt());
+  } else if (ignore_geometry_) {
+    // attribute only mode, one attribute row per feature
+    push_attributes(*poFeature, data);
+    ++data.n_features;
+  }
+}
+
+void OGRLoaderNode::read_features(OGRLayer* poLayer, OGRLayerData& data)
+{
+  OGRFeatureUniquePtr poFeature;
+  while( (poFeature = OGRFeatureUniquePtr(poLayer->GetNextFeature())) != nullptr )
+  {
+    read_feature(poFeature.get(), data);
+  }
+}
+
+/// Append the decoded data of a chunk of features to a layer
+inline void append_layer_data(OGRLayerData& dst, OGRLayerData& src) {
+  std::move(src.polygons.begin(), src.polygons.end(), std::back_inserter(dst.polygons));
+  std::move(src.line_strings.begin(), src.line_strings.end(), std::back_inserter(dst.line_strings));
+  dst.points.insert(dst.points.end(), src.points.begin(), src.points.end());
+  std::move(src.meshes.begin(), src.meshes.end(), std::back_inserter(dst.meshes));
+  std::move(src.mesh_labels.begin(), src.mesh_labels.end(), std::back_inserter(dst.mesh_labels));
+  std::move(src.wkt.begin(), src.wkt.end(), std::back_inserter(dst.wkt));
+  dst.area.insert(dst.area.end(), src.area.begin(), src.area.end());
+  dst.is_valid.insert(dst.is_valid.end(), src.is_valid.begin(), src.is_valid.end());
+  for (auto f : src.feature_index) dst.feature_index.push_back(f + int(dst.n_features));
+  dst.n_features += src.n_features;
+  dst.n_degenerate += src.n_degenerate;
+  for (size_t c = 0; c < dst.columns.size(); ++c) {
+    auto& values = src.columns[c].values;
+    if (dst.columns[c].is_dictionary) {
+      // the codes of src refer to its own dictionary
+      std::vector<int> codes;
+      for (auto& str : src.columns[c].dictionary) codes.push_back(intern_string(dst.columns[c], str));
+      for (auto& v : values) {
+        if (v.has_value()) v = codes[std::any_cast<int>(v)];
+      }
+    }
+    std::move(values.begin(), values.end(), std::back_inserter(dst.columns[c].values));
+  }
+}
+
+void OGRLoaderNode::read_features_parallel(OGRLayer* poLayer, OGRLayerData& data, size_t n_workers)
+{
+  // Fetching features from OGR is sequential, so this thread reads ahead
+  // chunks of raw features and a pool of workers decodes them (ring
+  // orientation, area, validity, wkt and attributes). The decoded chunks are
+  // appended to data in their original order.
+  const size_t chunk_size = 1024;
+  const size_t max_queued = 4 * n_workers;
+
+  struct Chunk {
+    size_t seq;
+    std::vector<OGRFeatureUniquePtr> features;
+  };
+  std::mutex mutex;
+  std::condition_variable work_cv, space_cv, done_cv;
+  std::deque<Chunk> queue;
+  std::map<size_t, OGRLayerData> results;
+  bool reading_done = false;
+  std::exception_ptr error;
+
+  OGRLayerData schema;
+  for (auto& column : data.columns) {
+    schema.columns.push_back({column.name, column.type, column.field_index, {}, column.decode, column.is_dictionary});
+  }
+
+  auto set_error = [&](std::exception_ptr e) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!error) error = e;
+    }
+    work_cv.notify_all();
+    space_cv.notify_all();
+    done_cv.notify_all();
+  };
+
+  auto worker = [&]() {
+    while (true) {
+      Chunk chunk;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        work_cv.wait(lock, [&]{ return error || reading_done || !queue.empty(); });
+        if (error || queue.empty()) return;
+        chunk = std::move(queue.front());
+        queue.pop_front();
+      }
+      space_cv.notify_one();
+
+      OGRLayerData chunk_data = schema;
+      try {
+        for (auto& poFeature : chunk.features) read_feature(poFeature.get(), chunk_data);
+        chunk.features.clear();
+      } catch (...) {
+        set_error(std::current_exception());
+        return;
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        results.emplace(chunk.seq, std::move(chunk_data));
+      }
+      done_cv.notify_one();
+    }
+  };
+
+  size_t n_chunks = 0, n_appended = 0;
+  auto append_results = [&](bool wait) {
+    while (n_appended < n_chunks) {
+      OGRLayerData chunk_data;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (wait) done_cv.wait(lock, [&]{ return error || results.count(n_appended); });
+        auto it = results.find(n_appended);
+        if (error || it == results.end()) return;
+        chunk_data = std::move(it->second);
+        results.erase(it);
+      }
+      append_layer_data(data, chunk_data);
+      ++n_appended;
+    }
+  };
+  auto submit = [&](Chunk& chunk) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      space_cv.wait(lock, [&]{ return error || queue.size() < max_queued; });
+      if (error) return false;
+      chunk.seq = n_chunks++;
+      queue.push_back(std::move(chunk));
+    }
+    work_cv.notify_one();
+    chunk = Chunk();
+    return true;
+  };
+
+  std::vector<std::thread> workers;
+  for (size_t t = 0; t < n_workers; ++t) workers.emplace_back(worker);
+
+  try {
+    Chunk chunk;
+    OGRFeatureUniquePtr poFeature;
+    while( (poFeature = OGRFeatureUniquePtr(poLayer->GetNextFeature())) != nullptr )
+    {
+      chunk.features.push_back(std::move(poFeature));
+      if (chunk.features.size() == chunk_size) {
+        if (!submit(chunk)) break;
+        append_results(false);
+      }
+    }
+    if (!chunk.features.empty()) submit(chunk);
+  } catch (...) {
+    set_error(std::current_exception());
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    reading_done = true;
+  }
+  work_cv.notify_all();
+
+  try {
+    append_results(true);
+  } catch (...) {
+    set_error(std::current_exception());
+  }
+  for (auto& thread : workers) thread.join();
+  if (error) std::rethrow_exception(error);
+}
+
+bool OGRLoaderNode::field_selected(const std::string& name)
+{
+  if (selected_fields_.empty()) return true;
+  for (auto& pattern : selected_fields_) {
+    if (wildcard_match(pattern.c_str(), name.c_str())) return true;
+  }
+  return false;
+}
+
+bool OGRLoaderNode::dictionary_field(const std::string& name)
+{
+  for (auto& pattern : dictionary_fields_list_) {
+    if (wildcard_match(pattern.c_str(), name.c_str())) return true;
+  }
+  return false;
+}
+
+std::vector<OGRSource> OGRLoaderNode::list_sources()
+{
+  // layer names can contain spaces (GPKG, FileGDB), so they are separated by
+  // semicolons
+  std::vector<std::string> layer_names;
+  for (auto name : split_string(manager.substitute_globals(layer_name_), ";")) {
+    name.erase(0, name.find_first_not_of(" \t"));
+    name.erase(name.find_last_not_of(" \t") + 1);
+    if (!name.empty()) layer_names.push_back(name);
+  }
+  bool fallback_to_id = layer_names.size() <= 1;
+  if (layer_names.empty()) layer_names.push_back("");
+
+  std::vector<OGRSource> sources;
+  auto paths = expand_filepaths(manager.substitute_globals(filepath));
+  for (auto& path : paths) {
+    for (auto& name : layer_names) {
+      sources.push_back({path, name, fallback_to_id, paths.size() == 1});
+    }
+  }
+  return sources;
+}
+
+void OGRLoaderNode::check_layers_found(const std::vector<OGRSource>& sources, const std::vector<bool>& found)
+{
+  std::unordered_map<std::string, bool> layers;
+  for (size_t k = 0; k < sources.size(); ++k) {
+    layers[sources[k].layer_name] = layers[sources[k].layer_name] || found[k] || sources[k].fallback_to_id;
+  }
+  for (auto& [name, layer_found] : layers) {
+    if (!layer_found)
+      throw(gfException("Layer '" + name + "' not found in any of the files of " + manager.substitute_globals(filepath)));
+  }
+}
+
+std::unique_ptr<OGRGeometry> OGRLoaderNode::create_spatial_filter()
+{
+  auto& filter_term = vector_input("spatial_filter");
+  if (filter_term.has_data()) {
+    // geoflow coordinates are relative to the data offset, OGR expects layer coordinates
+    arr3d offset = {0, 0, 0};
+    if (manager.data_offset().has_value())
+      offset = *manager.data_offset();
+
+    auto filter_geom = std::make_unique<OGRMultiPolygon>();
+    for (size_t i = 0; i < filter_term.size(); ++i) {
+      if (!filter_term.get_data_vec()[i].has_value()) continue;
+      auto& lr = filter_term.get<LinearRing>(i);
+      if (lr.size() < 3) continue;
+
+      OGRPolygon ogrpoly;
+      OGRLinearRing ogrring;
+      for (auto& p : lr) {
+        ogrring.addPoint(p[0] + offset[0], p[1] + offset[1]);
+      }
+      ogrring.closeRings();
+      ogrpoly.addRing(&ogrring);
+      filter_geom->addGeometry(&ogrpoly);
+    }
+    if (filter_geom->IsEmpty()) {
+      throw(gfException("spatial_filter input does not contain any valid polygon"));
+    }
+    return filter_geom;
+  } else if (spatial_filter_bbox_.size()) {
+    auto bbox_str = manager.substitute_globals(spatial_filter_bbox_);
+    std::istringstream bbox_ss(bbox_str);
+    double minx, miny, maxx, maxy;
+    if (!(bbox_ss >> minx >> miny >> maxx >> maxy) || minx > maxx || miny > maxy) {
+      throw(gfException("Invalid spatial filter bbox: " + bbox_str));
+    }
+    // equivalent to OGRLayer::SetSpatialFilterRect()
+    OGRLinearRing ogrring;
+    ogrring.addPoint(minx, miny);
+    ogrring.addPoint(maxx, miny);
+    ogrring.addPoint(maxx, maxy);
+    ogrring.addPoint(minx, maxy);
+    ogrring.closeRings();
+    auto filter_geom = std::make_unique<OGRPolygon>();
+    filter_geom->addRing(&ogrring);
+    return filter_geom;
+  }
+  return nullptr;
+}
+
+inline fs::file_time_type dataset_mtime(const std::string& path) {
+  // datasets that are not a regular file, like database connections, are
+  // never considered modified
+  std::error_code ec;
+  auto mtime = fs::last_write_time(path, ec);
+  return ec ? fs::file_time_type::min() : mtime;
+}
+
+OGRDatasetPool& OGRDatasetPool::instance()
+{
+  static OGRDatasetPool pool;
+  return pool;
+}
+
+OGRDatasetPtr OGRDatasetPool::open(const std::string& path, bool pooled)
+{
+  auto mtime = dataset_mtime(path);
+  if (pooled) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto it = idle_.begin(); it != idle_.end(); ++it) {
+      if ((*it)->path != path) continue;
+      if ((*it)->mtime == mtime) {
+        OGRDatasetPtr dataset((*it).release());
+        idle_.erase(it);
+        return dataset;
+      }
+      // the file has been modified since it was opened
+      idle_.erase(it);
+      break;
+    }
+  }
+
+  GDALDatasetUniquePtr poDS(GDALDataset::Open(path.c_str(), GDAL_OF_VECTOR | GDAL_OF_READONLY));
+  if (poDS == nullptr)
+    throw(gfException("Open failed on " + path));
+  return OGRDatasetPtr(new OGRPooledDataset{path, mtime, std::move(poDS), {}, pooled});
+}
+
+void OGRDatasetPool::release(OGRPooledDataset* dataset)
+{
+  std::unique_ptr<OGRPooledDataset> closing;
+  if (!dataset->pooled) {
+    delete dataset;
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_.emplace_front(dataset);
+    if (idle_.size() > capacity_) {
+      closing = std::move(idle_.back());
+      idle_.pop_back();
+    }
+  }
+  // close outside of the lock
+  closing.reset();
+}
+
+void OGRDatasetPool::set_capacity(size_t capacity)
+{
+  // nodes only ever grow the pool, so that the node that runs last does not
+  // decide the capacity for all of them
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_ = std::max(capacity_, capacity);
+}
+
+bool OGRDatasetPool::get_fid_range(const OGRPooledDataset& dataset, const std::string& layer_name, GIntBig& min, GIntBig& max)
+{
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = fid_ranges_.find({dataset.path, layer_name});
+  if (it == fid_ranges_.end() || it->second.mtime != dataset.mtime) return false;
+  min = it->second.min;
+  max = it->second.max;
+  return true;
+}
+
+void OGRDatasetPool::set_fid_range(const OGRPooledDataset& dataset, const std::string& layer_name, GIntBig min, GIntBig max)
+{
+  // only files tell when they have changed
+  if (dataset.mtime == fs::file_time_type::min()) return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  fid_ranges_[{dataset.path, layer_name}] = FIDRange{dataset.mtime, min, max};
+}
+
+void OGRDatasetReleaser::operator()(OGRPooledDataset* dataset) const
+{
+  OGRDatasetPool::instance().release(dataset);
+}
+
+std::string OGRLoaderNode::fid_shard_filter(const OGRPooledDataset& dataset, OGRLayer* poLayer)
+{
+  GDALDataset* poDS = dataset.ds.get();
+  auto quote = [](const std::string& name) {
+    std::string quoted = "\"";
+    for (char c : name) quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+    return quoted + "\"";
+  };
+  std::string fid_column = poLayer->GetFIDColumn();
+  std::string sql;
+  const char* dialect = nullptr;
+  GIntBig min_fid = 0, max_fid = -1;
+  bool known = false;
+  if (fid_column.empty()) {
+    // File formats without an FID column number their features from 0
+    // (Shapefile, FlatGeobuf) or from 1 (CSV, GML, OSM), and can have gaps
+    // (GeoJSON), so the range is queried as well. OGR SQL has no index to
+    // get it from and scans the whole layer, so the range is kept per file
+    // version and only queried once. The FID range filter of the shard is
+    // evaluated by OGR SQL as well, which reads the whole file once more.
+    known = OGRDatasetPool::instance().get_fid_range(dataset, poLayer->GetName(), min_fid, max_fid);
+    sql = "SELECT MIN(FID), MAX(FID) FROM " + quote(poLayer->GetName());
+    dialect = "OGRSQL";
+  } else {
+    // database backed layers have an index on the FID column, so this does not
+    // need a scan. PostgreSQL layer names are prefixed with their schema.
+    std::string table = quote(poLayer->GetName());
+    if (EQUAL(poDS->GetDriverName(), "PostgreSQL")) {
+      table.clear();
+      for (auto& part : split_string(poLayer->GetName(), ".")) {
+        if (table.size()) table += ".";
+        table += quote(part);
+      }
+    }
+    sql = "SELECT MIN(" + quote(fid_column) + "), MAX(" + quote(fid_column) + ") FROM " + table;
+  }
+
+  if (!known) {
+    OGRLayer* result = poDS->ExecuteSQL(sql.c_str(), nullptr, dialect);
+    if (result == nullptr)
+      throw(gfIOError("Unable to get the FID range of layer " + std::string(poLayer->GetName()) + ", it cannot be sharded by FID"));
+    OGRFeatureUniquePtr poFeature(result->GetNextFeature());
+    if (poFeature && poFeature->IsFieldSetAndNotNull(0) && poFeature->IsFieldSetAndNotNull(1)) {
+      min_fid = poFeature->GetFieldAsInteger64(0);
+      max_fid = poFeature->GetFieldAsInteger64(1);
+    }
+    poFeature.reset();
+    poDS->ReleaseResultSet(result);
+    if (fid_column.empty()) OGRDatasetPool::instance().set_fid_range(dataset, poLayer->GetName(), min_fid, max_fid);
+  }
+  fid_column = fid_column.empty() ? "FID" : quote(fid_column);
+
+  // split the FID range in shard_count parts that differ at most 1 in size
+  GIntBig span = std::max<GIntBig>(0, max_fid - min_fid + 1);
+  GIntBig part = span / shard_count_, rest = span % shard_count_;
+  GIntBig begin = min_fid + part * shard_index_ + std::min<GIntBig>(shard_index_, rest);
+  GIntBig end = begin + part + (shard_index_ < rest ? 1 : 0);
+  return fid_column + " >= " + std::to_string(begin) + " AND " + fid_column + " < " + std::to_string(end);
+}
+
+std::array<double, 4> OGRLoaderNode::spatial_shard_box(OGRLayer* poLayer)
+{
+  OGREnvelope extent;
+  if (poLayer->GetExtent(&extent, TRUE) != OGRERR_NONE)
+    throw(gfIOError("Unable to get the extent of layer " + std::string(poLayer->GetName())));
+
+  // pick the grid of shard_count tiles that has the most square tiles
+  double width = std::max(extent.MaxX - extent.MinX, 1e-9);
+  double height = std::max(extent.MaxY - extent.MinY, 1e-9);
+  int n_cols = 1;
+  double best = std::numeric_limits<double>::max();
+  for (int cols = 1; cols <= shard_count_; ++cols) {
+    if (shard_count_ % cols) continue;
+    int rows = shard_count_ / cols;
+    double score = std::abs(std::log((width / cols) / (height / rows)));
+    if (score < best) {
+      best = score;
+      n_cols = cols;
+    }
+  }
+  int n_rows = shard_count_ / n_cols;
+  int col = shard_index_ % n_cols, row = shard_index_ / n_cols;
+
+  // the outer tiles are unbounded so that vertices on the extent boundary
+  // belong to exactly one tile
+  double inf = std::numeric_limits<double>::infinity();
+  return {
+    col == 0 ? -inf : extent.MinX + width * col / n_cols,
+    row == 0 ? -inf : extent.MinY + height * row / n_rows,
+    col == n_cols - 1 ? inf : extent.MinX + width * (col + 1) / n_cols,
+    row == n_rows - 1 ? inf : extent.MinY + height * (row + 1) / n_rows
+  };
+}
+
+/// Number of geometry rows of a layer with a single geometry type, or the
+/// number of features if the geometries are not read. Returns -1 if the layer
+/// has multiple geometry types.
+inline long layer_rows(const OGRLayerData& data) {
+  if (!data.polygons.empty() + !data.line_strings.empty() + !data.points.empty() + !data.meshes.empty() > 1)
+    return -1;
+  if (data.polygons.size()) return long(data.polygons.size());
+  if (data.line_strings.size()) return long(data.line_strings.size());
+  if (data.meshes.size()) return long(data.meshes.size());
+  if (data.points.size()) return long(data.points.size());
+  return long(data.n_features);
+}
+
+/// Select the rows of a layer for which keep is set. Values that are stored
+/// once per feature are kept if any of the parts of the feature is kept, and
+/// the feature_index is renumbered. The values are moved out of data when it
+/// is passed as an rvalue.
+template <typename Data> inline OGRLayerData select_rows(Data&& data, const std::vector<bool>& keep) {
+  constexpr bool move = !std::is_lvalue_reference_v<Data>;
+  size_t n_rows = keep.size();
+
+  std::vector<bool> keep_feature;
+  std::vector<int> new_index;
+  size_t n_features = 0;
+  if (data.feature_index.size() == n_rows) {
+    keep_feature.assign(data.n_features, false);
+    for (size_t i = 0; i < n_rows; ++i) {
+      if (keep[i]) keep_feature[data.feature_index[i]] = true;
     }
-    else if (mterm->accepts_type(typeid(int)))
-    {
-      if(name == "OGR_FID") {
-        mterm->push_back(int(poFeature.GetFID()));
-      } else {
-        mterm->push_back(int(poFeature.GetFieldAsInteger64(name.c_str())));
-      }
+    new_index.assign(keep_feature.size(), -1);
+    for (size_t f = 0; f < keep_feature.size(); ++f) {
+      if (keep_feature[f]) new_index[f] = int(n_features++);
     }
-    else if (mterm->accepts_type(typeid(float)))
-    {
-      mterm->push_back(float(poFeature.GetFieldAsDouble(name.c_str())));
+  } else {
+    // without geometries every row is a feature
+    keep_feature = keep;
+    n_features = std::count(keep.begin(), keep.end(), true);
+  }
+
+  OGRLayerData selection;
+  selection.layer_name = data.layer_name;
+  selection.geometry_type_name = data.geometry_type_name;
+  selection.srs_wkt = data.srs_wkt;
+  selection.driver_name = data.driver_name;
+  selection.labels_field = data.labels_field;
+  selection.has_shard_box = data.has_shard_box;
+  selection.shard_box = data.shard_box;
+  selection.n_features = n_features;
+  selection.n_degenerate = data.n_degenerate;
+
+  auto take = [&](auto& values, auto& selected) {
+    // vectors that are not aligned with the geometries or features are taken as they are
+    auto& mask = values.size() == n_rows ? keep : keep_feature;
+    if (values.size() != mask.size()) {
+      if constexpr (move) selected = std::move(values);
+      else selected = values;
+      return;
     }
-    else if (mterm->accepts_type(typeid(std::string)))
-    {
-      mterm->push_back((std::string)poFeature.GetFieldAsString(name.c_str()));
+    for (size_t i = 0; i < mask.size(); ++i) {
+      if (!mask[i]) continue;
+      if constexpr (move) selected.push_back(std::move(values[i]));
+      else selected.push_back(values[i]);
     }
-    else if (mterm->accepts_type(typeid(Date)))
-    {
-      DateTime t;
-      poFeature.GetFieldAsDateTime(fieldNameMap[name], &t.date.year, &t.date.month, &t.date.day, nullptr, nullptr, &t.time.second, nullptr);
-      mterm->push_back(t.date);
+  };
+  take(data.polygons, selection.polygons);
+  take(data.line_strings, selection.line_strings);
+  take(data.points, selection.points);
+  take(data.meshes, selection.meshes);
+  take(data.mesh_labels, selection.mesh_labels);
+  take(data.wkt, selection.wkt);
+  take(data.area, selection.area);
+  take(data.is_valid, selection.is_valid);
+  take(data.feature_index, selection.feature_index);
+  for (auto& f : selection.feature_index) {
+    if (new_index.size()) f = new_index[f];
+  }
+  for (auto& column : data.columns) {
+    selection.columns.push_back({column.name, column.type, column.field_index, {}, column.decode, column.is_dictionary, column.dictionary, column.dictionary_codes});
+    take(column.values, selection.columns.back().values);
+  }
+  return selection;
+}
+
+/// Drop the rows of which the first vertex is outside the shard box
+inline void filter_shard_rows(OGRLayerData& data) {
+  if (!data.has_shard_box) return;
+  if (layer_rows(data) < 0) {
+    std::cout << "Layer '" << data.layer_name << "' has multiple geometry types, spatial sharding is not applied\n";
+    return;
+  }
+  auto& box = data.shard_box;
+  auto point_in_box = [&box](const arr3d& p) {
+    return p[0] >= box[0] && p[1] >= box[1] && p[0] < box[2] && p[1] < box[3];
+  };
+  auto in_box = [&point_in_box](const std::vector<arr3d>& points) {
+    return !points.empty() && point_in_box(points[0]);
+  };
+  std::vector<bool> keep;
+  if (data.polygons.size()) {
+    for (auto& polygon : data.polygons) keep.push_back(polygon.size() && in_box(polygon[0]));
+  } else if (data.line_strings.size()) {
+    for (auto& line_string : data.line_strings) keep.push_back(in_box(line_string));
+  } else if (data.meshes.size()) {
+    for (auto& mesh : data.meshes) keep.push_back(mesh.size() && in_box(mesh[0][0]));
+  } else {
+    for (auto& p : data.points) keep.push_back(point_in_box(p));
+  }
+  data = select_rows(std::move(data), keep);
+}
+
+inline void add_ring_points(const std::vector<arr3d>& points, OGRLinearRing& ring) {
+  for (auto& p : points) ring.addPoint(p[0], p[1]);
+  ring.closeRings();
+}
+
+/// Whether geometry row i of a layer intersects a spatial filter, with the
+/// envelope of the filter precomputed. If the filter is a box, rows inside the
+/// box are accepted without an exact intersection test.
+inline bool row_intersects(const OGRLayerData& data, size_t i, const OGRGeometry* filter, const OGREnvelope& filter_envelope, bool filter_is_box) {
+  OGREnvelope envelope;
+  auto merge = [&envelope](const std::vector<arr3d>& points) {
+    for (auto& p : points) envelope.Merge(p[0], p[1]);
+  };
+  if (data.polygons.size()) {
+    if (data.polygons[i].empty()) return false;
+    merge(data.polygons[i][0]);
+  } else if (data.line_strings.size()) {
+    merge(data.line_strings[i]);
+  } else if (data.meshes.size()) {
+    for (auto& polygon : data.meshes[i]) {
+      if (polygon.size()) merge(polygon[0]);
     }
-    else if (mterm->accepts_type(typeid(Time)))
-    {
-      Time time;
-      poFeature.GetFieldAsDateTime(fieldNameMap[name], nullptr, nullptr, nullptr, &time.hour, &time.minute, &time.second, &time.timeZone);
-      mterm->push_back(time);
+  } else {
+    envelope.Merge(data.points[i][0], data.points[i][1]);
+  }
+  if (!envelope.IsInit() || !filter_envelope.Intersects(envelope)) return false;
+  if (filter_is_box && filter_envelope.Contains(envelope)) return true;
+
+  std::unique_ptr<OGRGeometry> geometry;
+  if (data.polygons.size()) {
+    auto polygon = std::make_unique<OGRPolygon>();
+    for (auto& points : data.polygons[i]) {
+      OGRLinearRing ring;
+      add_ring_points(points, ring);
+      polygon->addRing(&ring);
     }
-    else if (mterm->accepts_type(typeid(DateTime)))
-    {
-      DateTime t;
-      poFeature.GetFieldAsDateTime(fieldNameMap[name], &t.date.year, &t.date.month, &t.date.day, &t.time.hour, &t.time.minute, &t.time.second, &t.time.timeZone);
-      mterm->push_back(t);
+    geometry = std::move(polygon);
+  } else if (data.line_strings.size()) {
+    auto line_string = std::make_unique<OGRLineString>();
+    for (auto& p : data.line_strings[i]) line_string->addPoint(p[0], p[1]);
+    geometry = std::move(line_string);
+  } else if (data.meshes.size()) {
+    auto multi_polygon = std::make_unique<OGRMultiPolygon>();
+    for (auto& rings : data.meshes[i]) {
+      OGRPolygon polygon;
+      for (auto& points : rings) {
+        OGRLinearRing ring;
+        add_ring_points(points, ring);
+        polygon.addRing(&ring);
+      }
+      multi_polygon->addGeometry(&polygon);
     }
+    geometry = std::move(multi_polygon);
+  } else {
+    geometry = std::make_unique<OGRPoint>(data.points[i][0], data.points[i][1]);
   }
+  return filter->Intersects(geometry.get());
 }
 
-void OGRLoaderNode::read_polygon(OGRPolygon* poPolygon) {
-  LinearRing gf_polygon;
-  // for(auto& poPoint : poPolygon->getExteriorRing()) {
-  OGRPoint poPoint;
-  auto ogr_ering = poPolygon->getExteriorRing();
-  
-  // ensure we output ccw exterior ring
-  if ( ogr_ering->isClockwise() ) {
-    ogr_ering->reverseWindingOrder();
-  }
-  for (size_t i = 0; i < ogr_ering->getNumPoints() - 1; ++i)
-  {
-    ogr_ering->getPoint(i, &poPoint);
-    std::array<float, 3> p = manager.coord_transform_fwd(
-        poPoint.getX(),
-        poPoint.getY(),
-        base_elevation==0 ? poPoint.getZ() : base_elevation
-      );
-    gf_polygon.push_back(p);
-  }
-  // also read the interior rings (holes)
-  for (size_t i = 0; i < poPolygon->getNumInteriorRings(); ++i) 
-  {
-    auto ogr_iring = poPolygon->getInteriorRing(i);
-    // ensure we output cw interior ring
-    if ( !ogr_iring->isClockwise() ) {
-      ogr_iring->reverseWindingOrder();
+/// Rows of a layer that is kept in memory that satisfy the attribute filter
+/// and the spatial filter. Like OGR, the spatial filter keeps the features of
+/// which any part intersects it. Returns false if the filters cannot be
+/// evaluated on this layer, because a column of the attribute filter was not
+/// read or the layer has multiple geometry types.
+inline bool filter_rows(const OGRLayerData& data, OGRAttributeFilter* filter, const OGRGeometry* spatial_filter, bool filter_is_box, std::vector<bool>& keep) {
+  long n_rows = layer_rows(data);
+  if (n_rows < 0) return false;
+  bool has_geometry = size_t(n_rows) == data.feature_index.size();
+  keep.assign(n_rows, true);
+
+  if (filter) {
+    if (!filter->bind(data)) return false;
+    size_t n_attribute_rows = data.columns.empty() ? size_t(n_rows) : data.columns[0].values.size();
+    if (n_attribute_rows == size_t(n_rows)) {
+      for (size_t i = 0; i < keep.size(); ++i) keep[i] = filter->evaluate(i);
+    } else if (has_geometry && n_attribute_rows == data.n_features) {
+      // attributes_per_feature mode
+      std::vector<bool> keep_feature(data.n_features);
+      for (size_t f = 0; f < keep_feature.size(); ++f) keep_feature[f] = filter->evaluate(f);
+      for (size_t i = 0; i < keep.size(); ++i) keep[i] = keep_feature[data.feature_index[i]];
+    } else {
+      return false;
     }
-    vec3f gf_iring;
-    for (size_t j = 0; j < ogr_iring->getNumPoints() - 1; ++j)
-    {
-      ogr_iring->getPoint(j, &poPoint);
-      std::array<float, 3> p = manager.coord_transform_fwd(
-        poPoint.getX(),
-        poPoint.getY(),
-        base_elevation==0 ? poPoint.getZ() : base_elevation
-      );
-      gf_iring.push_back(p);
+  }
+
+  if (spatial_filter && has_geometry) {
+    OGREnvelope filter_envelope;
+    spatial_filter->getEnvelope(&filter_envelope);
+    std::vector<bool> hit(data.n_features, false);
+    for (size_t i = 0; i < keep.size(); ++i) {
+      size_t f = data.feature_index[i];
+      if (keep[i] && !hit[f])
+        hit[f] = row_intersects(data, i, spatial_filter, filter_envelope, filter_is_box);
     }
-    gf_polygon.interior_rings().push_back(gf_iring);
+    for (size_t i = 0; i < keep.size(); ++i) keep[i] = keep[i] && hit[data.feature_index[i]];
   }
-  vector_output("linear_rings").push_back(gf_polygon);
+  return true;
 }
 
-void OGRLoaderNode::process()
+OGRLayer* OGRLoaderNode::open_source(const OGRSource& source, const std::string& attribute_filter, OGRGeometry* spatial_filter, OGRDatasetPtr& dataset, OGRLayerData& data)
 {
-  GDALDatasetUniquePtr poDS(GDALDataset::Open(manager.substitute_globals(filepath).c_str(), GDAL_OF_VECTOR));
-  if (poDS == nullptr)
-    throw(gfException("Open failed on " + manager.substitute_globals(filepath)));
-  layer_count = poDS->GetLayerCount();
-  std::cout << "Layer count: " << layer_count << "\n";
+  dataset = OGRDatasetPool::instance().open(source.path, dataset_pool_size_ > 0);
+  GDALDataset* poDS = dataset->ds.get();
+  auto layer_count = poDS->GetLayerCount();
 
-  OGRLayer *poLayer;
-  
-  auto layer_name = manager.substitute_globals(layer_name_).c_str();
-  poLayer = poDS->GetLayerByName( layer_name );
+  OGRLayer *poLayer = nullptr;
+  if (!source.layer_name.empty())
+    poLayer = poDS->GetLayerByName( source.layer_name.c_str() );
   if (poLayer == nullptr) {
+    // skip files that do not contain this layer when reading multiple files,
+    // check_layers_found() checks that some file has it
+    if (!source.fallback_to_id) {
+      if (source.required)
+        throw(gfException("Layer '" + source.layer_name + "' not found in " + source.path));
+      return nullptr;
+    }
     if (layer_id >= layer_count) {
       throw(gfException("Illegal layer ID! Layer ID must be less than the layer count."));
     } else if (layer_id < 0) {
       throw(gfException("Illegal layer ID! Layer ID cannot be negative."));
     }
     poLayer = poDS->GetLayer( layer_id) ;
-    // throw(gfException("Could not get the selected layer by name=" + layer_name));
   }
   if (poLayer == nullptr)
     throw(gfException("Could not get the selected layer "));
+  // a layer of a pooled dataset still has the filters of its previous use,
+  // they are cleared before the layer is counted or measured for sharding
+  poLayer->SetAttributeFilter(nullptr);
+  poLayer->SetSpatialFilter(nullptr);
 
+  data.layer_name = poLayer->GetName();
+  data.geometry_type_name = OGRGeometryTypeToName(poLayer->GetGeomType());
+  data.driver_name = poDS->GetDriverName();
 
-  std::cout << "Layer '" << poLayer->GetName() << "' feature count: " << poLayer->GetFeatureCount() << "\n";
-  geometry_type = poLayer->GetGeomType();
-  geometry_type_name = OGRGeometryTypeToName(geometry_type);
-  std::cout << "Layer geometry type: " << geometry_type_name << "\n";
+  auto srs_it = dataset->srs_wkt.find(data.layer_name);
+  if (srs_it == dataset->srs_wkt.end()) {
+    std::string srs_wkt;
+    OGRSpatialReference* layerSRS = poLayer->GetSpatialRef();
+    if (layerSRS != nullptr) {
+      char *pszWKT = NULL;
+      layerSRS->exportToWkt( &pszWKT );
+      srs_wkt = pszWKT;
+      CPLFree(pszWKT);
+    }
+    srs_it = dataset->srs_wkt.emplace(data.layer_name, srs_wkt).first;
+  }
+  data.srs_wkt = srs_it->second;
 
   auto layer_def = poLayer->GetLayerDefn();
   auto field_count = layer_def->GetFieldCount();
-
-  // Set up vertex data (and buffer(s)) and attribute pointers
-  // LineStringCollection line_strings;
-  // LinearRingCollection linear_rings;
-  auto &linear_rings = vector_output("linear_rings");
-  auto &line_strings = vector_output("line_strings");
-  
-  auto &is_valid = vector_output("is_valid");
-  auto &area = vector_output("area");
-
-  std::unordered_map<std::string,int> fieldNameMap;
-  for (size_t i = 0; i < field_count; ++i)
+  // Fields that are not selected are ignored by the driver and not decoded,
+  // except for the fields of the attribute filter. Most drivers evaluate the
+  // filter on the fetched features, where ignored fields are null. If the
+  // filter cannot be tokenized no fields are ignored.
+  std::vector<std::string> filter_identifiers;
+  bool ignore_fields = true;
+  if (!attribute_filter.empty()) {
+    try {
+      filter_identifiers = OGRAttributeFilter::identifiers(attribute_filter);
+    } catch (const gfException&) {
+      ignore_fields = false;
+    }
+  }
+  auto filter_field = [&filter_identifiers](const std::string& field_name) {
+    for (auto& identifier : filter_identifiers) {
+      if (EQUAL(identifier.c_str(), field_name.c_str())) return true;
+    }
+    return false;
+  };
+  std::vector<std::string> ignored_fields;
+  for (int i = 0; i < field_count; ++i)
   {
     auto field_def = layer_def->GetFieldDefn(i);
     auto t = field_def->GetType();
     auto field_name = (std::string)field_def->GetNameRef();
-    fieldNameMap[field_name] = i;
+    // the labels of meshes are always read
+    if (!field_selected(field_name) && !(read_meshes_ && field_name == "labels")) {
+      if (ignore_fields && !filter_field(field_name)) ignored_fields.push_back(field_name);
+      continue;
+    }
     if ((t == OFTInteger) && (field_def->GetSubType() == OFSTBoolean)) 
     {
-      auto &term = poly_output("attributes").add_vector(field_name, typeid(bool));
+      data.columns.push_back({field_name, typeid(bool), i, {}, decode_bool});
     } 
-    else if (t == OFTInteger || t == OFTInteger64)
+    else if (t == OFTInteger)
+    {
+      data.columns.push_back({field_name, typeid(int), i, {}, decode_int});
+    }
+    else if (t == OFTInteger64)
+    {
+      data.columns.push_back({field_name, typeid(int), i, {}, decode_int64});
+    }
+    else if (t == OFTString && dictionary_field(field_name))
     {
-      auto &term = poly_output("attributes").add_vector(field_name, typeid(int));
-      // term.set(vec1i());
+      data.columns.push_back({field_name, typeid(int), i, {}, decode_string_code, true});
     }
     else if (t == OFTString)
     {
-      auto &term = poly_output("attributes").add_vector(field_name, typeid(std::string));
-      // term.set(vec1s());
+      data.columns.push_back({field_name, typeid(std::string), i, {}, decode_string});
     }
     else if (t == OFTReal)
     {
-      auto &term = poly_output("attributes").add_vector(field_name, typeid(float));
-      // term.set(vec1f());
+      data.columns.push_back({field_name, typeid(float), i, {}, decode_real});
     }
     else if (t == OFTDate)
     {
-      auto &term = poly_output("attributes").add_vector(field_name, typeid(Date));
-      // term.set(vec1f());
+      data.columns.push_back({field_name, typeid(Date), i, {}, decode_date});
     }
     else if (t == OFTTime)
     {
-      auto &term = poly_output("attributes").add_vector(field_name, typeid(Time));
-      // term.set(vec1f());
+      data.columns.push_back({field_name, typeid(Time), i, {}, decode_time});
     }
     else if (t == OFTDateTime)
     {
-      auto &term = poly_output("attributes").add_vector(field_name, typeid(DateTime));
-      // term.set(vec1f());
+      data.columns.push_back({field_name, typeid(DateTime), i, {}, decode_datetime});
     }
   }
-
   if(output_fid_)
-    auto &ogrfid_term = poly_output("attributes").add_vector("OGR_FID", typeid(int));
+    data.columns.push_back({"OGR_FID", typeid(int), -1, {}, decode_fid});
+  if (read_meshes_) {
+    data.labels_field = layer_def->GetFieldIndex("labels");
+    if (data.labels_field != -1 && layer_def->GetFieldDefn(data.labels_field)->GetType() != OFTIntegerList)
+      data.labels_field = -1;
+  }
+
+  // Sharding reduces to an FID range filter or a tile of the layer extent, so
+  // that drivers only read the features of this shard. The extent and FID
+  // range are those of the whole layer, so the shards do not depend on the
+  // filters.
+  std::string filter = attribute_filter;
+  std::unique_ptr<OGRGeometry> tile_filter;
+  if (shard_count_ > 1 && !shard_spatial_) {
+    auto shard_filter = fid_shard_filter(*dataset, poLayer);
+    filter = filter.empty() ? shard_filter : "(" + filter + ") AND " + shard_filter;
+  } else if (shard_count_ > 1) {
+    data.has_shard_box = true;
+    data.shard_box = spatial_shard_box(poLayer);
+    if (spatial_filter == nullptr) {
+      OGREnvelope extent;
+      poLayer->GetExtent(&extent, TRUE);
+      auto& box = data.shard_box;
+      auto tile = std::make_unique<OGRPolygon>();
+      OGRLinearRing ring;
+      double minx = std::max(box[0], extent.MinX), miny = std::max(box[1], extent.MinY);
+      double maxx = std::min(box[2], extent.MaxX), maxy = std::min(box[3], extent.MaxY);
+      ring.addPoint(minx, miny);
+      ring.addPoint(maxx, miny);
+      ring.addPoint(maxx, maxy);
+      ring.addPoint(minx, maxy);
+      ring.closeRings();
+      tile->addRing(&ring);
+      tile_filter = std::move(tile);
+      spatial_filter = tile_filter.get();
+    }
+  }
 
-  // bool found_offset = manager.data_offset().has_value();
+  // a pooled dataset keeps the ignored fields of its previous use, so they are
+  // always set. This comes after the FID range query of the sharding, OGR SQL
+  // resets the ignored fields of the layer it reads.
+  if (ignored_fields.size())
+    ignored_fields.push_back("OGR_STYLE");
+  // the geometry is needed by the spatial filter
+  if (ignore_geometry_ && spatial_filter == nullptr)
+    ignored_fields.push_back("OGR_GEOMETRY");
+  std::vector<const char*> ignored_list;
+  for (auto& name : ignored_fields) ignored_list.push_back(name.c_str());
+  ignored_list.push_back(nullptr);
+  if (poLayer->SetIgnoredFields(ignored_list.data()) != OGRERR_NONE)
+    throw(gfIOError("Unable to set ignored fields on layer " + data.layer_name));
+
+  auto error_code = poLayer->SetAttributeFilter(filter.size() ? filter.c_str() : nullptr);
+  if (OGRERR_NONE != error_code) {
+    throw(gfIOError("Invalid attribute filter: OGRErr="+std::to_string(error_code)+", filter="+filter));
+  }
+  // The spatial filter is handed to OGR so that drivers with a spatial index
+  // (GPKG, FlatGeobuf, PostGIS, Shapefile with .qix) only return the features
+  // that are actually needed. With spatial sharding every feature that has
+  // its first vertex in the tile intersects the tile, the rows of the other
+  // tiles are dropped after decoding.
+  poLayer->SetSpatialFilter(spatial_filter);
   poLayer->ResetReading();
+  return poLayer;
+}
 
-  
-  // if ((poLayer->GetFeatureCount()) < feature_select || feature_select < 0)
-  //   throw gfIOError("Illegal feature_select value");
+void OGRLoaderNode::read_source(const OGRSource& source, const std::string& attribute_filter, OGRGeometry* spatial_filter, OGRLayerData& data)
+{
+  std::string key;
+  if (!cache_dir_.empty()) {
+    key = cache_file_key(source);
+    if (!key.empty() && load_cache(key, data)) {
+      std::cout << "Loaded " << source.path << " from cache\n";
+      return;
+    }
+  }
+
+  OGRDatasetPtr dataset;
+  auto poLayer = open_source(source, attribute_filter, spatial_filter, dataset, data);
+  if (poLayer == nullptr) return;
+  // only use the feature count if the driver can get it without a full scan
+  reserve_layer_data(data, poLayer->GetFeatureCount(FALSE));
+
+  if (use_arrow_stream_ && read_meshes_) {
+    std::cout << "use_arrow_stream is not supported with read_meshes, reading features one by one\n";
+    read_features(poLayer, data);
+  } else if (use_arrow_stream_) {
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,6,0)
+    read_arrow_stream(poLayer, data);
+#else
+    std::cout << "use_arrow_stream requires GDAL 3.6 or newer, reading features one by one\n";
+    read_features(poLayer, data);
+#endif
+  } else if (decode_threads_ > 0) {
+    read_features_parallel(poLayer, data, decode_threads_);
+  } else {
+    read_features(poLayer, data);
+  }
+  filter_shard_rows(data);
+  if (!key.empty()) save_cache(key, data);
+}
+
+// Snapshot cache of decoded layers. The file starts with a magic string and
+// the full cache key, followed by the layer data. Coordinates are stored as
+// contiguous arrays of doubles in the layer CRS, so a snapshot stays valid
+// when base_elevation or the data offset change. Attribute columns are stored
+// as arrays of their values that are set, field by field for dates and times.
+const char OGR_CACHE_MAGIC[8] = {'G', 'F', 'O', 'G', 'R', 'C', '0', '7'};
+
+enum class CacheType : uint8_t { BOOL, INT, FLOAT, STRING, DATE, TIME, DATETIME };
+
+template <typename T> inline void cache_write(std::ostream& os, const T& v) {
+  os.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+template <typename T> inline bool cache_read(std::istream& is, T& v) {
+  return bool(is.read(reinterpret_cast<char*>(&v), sizeof(T)));
+}
+inline void cache_write_string(std::ostream& os, const std::string& s) {
+  cache_write(os, uint64_t(s.size()));
+  os.write(s.data(), s.size());
+}
+inline bool cache_read_string(std::istream& is, std::string& s) {
+  uint64_t n;
+  if (!cache_read(is, n)) return false;
+  s.resize(n);
+  return bool(is.read(s.data(), n));
+}
+template <typename T> inline void cache_write_array(std::ostream& os, const std::vector<T>& values) {
+  cache_write(os, uint64_t(values.size()));
+  os.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+}
+template <typename T> inline bool cache_read_array(std::istream& is, std::vector<T>& values) {
+  uint64_t n;
+  if (!cache_read(is, n)) return false;
+  values.resize(n);
+  return bool(is.read(reinterpret_cast<char*>(values.data()), n * sizeof(T)));
+}
+inline void cache_write_points(std::ostream& os, const std::vector<arr3d>& points) {
+  cache_write_array(os, points);
+}
+inline bool cache_read_points(std::istream& is, std::vector<arr3d>& points) {
+  return cache_read_array(is, points);
+}
+
+/// The values of a column that are set, converted to the type they are stored
+/// as
+template <typename Stored, typename T> inline std::vector<Stored> cache_values(const std::vector<std::any>& values) {
+  std::vector<Stored> result;
+  for (auto& value : values) {
+    if (value.has_value()) result.push_back(Stored(std::any_cast<const T&>(value)));
+  }
+  return result;
+}
+
+/// Date and time values stored field by field, as an array of their integer
+/// fields and an array of their seconds. This does not depend on the layout
+/// and padding of the structs.
+struct CacheDateTimes {
+  std::vector<int32_t> fields;
+  std::vector<float> seconds;
+  // read positions in fields and seconds
+  size_t f = 0, s = 0;
+
+  void push(const Date& d) {
+    fields.insert(fields.end(), {d.year, d.month, d.day});
+  }
+  void push(const Time& t) {
+    fields.insert(fields.end(), {t.hour, t.minute, t.timeZone});
+    seconds.push_back(t.second);
+  }
+  void push(const DateTime& dt) {
+    push(dt.date);
+    push(dt.time);
+  }
+  template <typename T> void push_values(const std::vector<std::any>& values) {
+    for (auto& value : values) {
+      if (value.has_value()) push(std::any_cast<const T&>(value));
+    }
+  }
+  // whether the arrays hold n values of type code
+  bool holds(CacheType code, size_t n) const {
+    size_t n_fields = code == CacheType::DATETIME ? 6 : 3;
+    size_t n_seconds = code == CacheType::DATE ? 0 : 1;
+    return fields.size() == n * n_fields && seconds.size() == n * n_seconds;
+  }
+  Date date() {
+    Date d;
+    d.year = fields[f++];
+    d.month = fields[f++];
+    d.day = fields[f++];
+    return d;
+  }
+  Time time() {
+    Time t;
+    t.hour = fields[f++];
+    t.minute = fields[f++];
+    t.timeZone = fields[f++];
+    t.second = seconds[s++];
+    return t;
+  }
+  DateTime date_time() {
+    DateTime dt;
+    dt.date = date();
+    dt.time = time();
+    return dt;
+  }
+};
+
+inline bool cache_type(std::type_index type, CacheType& code) {
+  if (type == typeid(bool)) code = CacheType::BOOL;
+  else if (type == typeid(int)) code = CacheType::INT;
+  else if (type == typeid(float)) code = CacheType::FLOAT;
+  else if (type == typeid(std::string)) code = CacheType::STRING;
+  else if (type == typeid(Date)) code = CacheType::DATE;
+  else if (type == typeid(Time)) code = CacheType::TIME;
+  else if (type == typeid(DateTime)) code = CacheType::DATETIME;
+  else return false;
+  return true;
+}
+inline std::type_index cache_type_index(CacheType code) {
+  switch (code) {
+    case CacheType::BOOL: return typeid(bool);
+    case CacheType::INT: return typeid(int);
+    case CacheType::FLOAT: return typeid(float);
+    case CacheType::STRING: return typeid(std::string);
+    case CacheType::DATE: return typeid(Date);
+    case CacheType::TIME: return typeid(Time);
+    default: return typeid(DateTime);
+  }
+}
 
-  char *pszWKT = NULL;
-  OGRSpatialReference* layerSRS = poLayer->GetSpatialRef();
-  layerSRS->exportToWkt( &pszWKT );
-  // printf( "Layer SRS: \n %s\n", pszWKT );
-  manager.set_fwd_crs_transform(pszWKT);
-  CPLFree(pszWKT);
+inline void write_layer_cache(std::ostream& os, const std::string& key, const OGRLayerData& data) {
+  os.write(OGR_CACHE_MAGIC, sizeof(OGR_CACHE_MAGIC));
+  cache_write_string(os, key);
+  cache_write_string(os, data.layer_name);
+  cache_write_string(os, data.geometry_type_name);
+  cache_write_string(os, data.srs_wkt);
+  cache_write_string(os, data.driver_name);
 
-  if (attribute_filter_.size()) {
-    auto attribute_filter = manager.substitute_globals(attribute_filter_);
-    auto error_code = poLayer->SetAttributeFilter(attribute_filter.c_str());
-    if (OGRERR_NONE != error_code) {
-      throw(gfIOError("Invalid attribute filter: OGRErr="+std::to_string(error_code)+", filter="+attribute_filter));
+  cache_write(os, uint64_t(data.polygons.size()));
+  for (auto& polygon : data.polygons) {
+    cache_write(os, uint32_t(polygon.size()));
+    for (auto& ring : polygon) cache_write_points(os, ring);
+  }
+  cache_write(os, uint64_t(data.line_strings.size()));
+  for (auto& line_string : data.line_strings) cache_write_points(os, line_string);
+  cache_write_points(os, data.points);
+  cache_write(os, uint64_t(data.meshes.size()));
+  for (size_t m = 0; m < data.meshes.size(); ++m) {
+    cache_write(os, uint32_t(data.meshes[m].size()));
+    for (auto& polygon : data.meshes[m]) {
+      cache_write(os, uint32_t(polygon.size()));
+      for (auto& ring : polygon) cache_write_points(os, ring);
     }
+    auto& labels = data.mesh_labels[m];
+    cache_write(os, uint32_t(labels.size()));
+    os.write(reinterpret_cast<const char*>(labels.data()), labels.size() * sizeof(int));
   }
 
-  size_t fid{1};
-  OGRFeature *poFeature;
-  while( (poFeature = poLayer->GetNextFeature()) != NULL )
-  // for (auto &poFeature : poLayer)
-  {
-    // if(feature_select != 0 && fid++ != feature_select) continue;
-
-    // read feature geometry
-    OGRGeometry *poGeometry;
-    
-    poGeometry = poFeature->GetGeometryRef();
-    output("wkt").push_back(poGeometry->exportToWkt());
-    // std::cout << "Layer geometry type: " << poGeometry->getGeometryType() << " , " << geometry_type << "\n";
-    if (poGeometry != nullptr) // FIXME: we should check if te layer geometrytype matches with this feature's geometry type. Messy because they can be a bit different eg. wkbLineStringZM and wkbLineString25D
-    {
+  cache_write(os, uint64_t(data.wkt.size()));
+  for (auto& wkt : data.wkt) cache_write_string(os, wkt);
+  cache_write(os, uint64_t(data.area.size()));
+  os.write(reinterpret_cast<const char*>(data.area.data()), data.area.size() * sizeof(float));
+  cache_write(os, uint64_t(data.is_valid.size()));
+  for (bool v : data.is_valid) cache_write(os, uint8_t(v));
+  cache_write(os, uint64_t(data.n_features));
+  cache_write(os, uint64_t(data.feature_index.size()));
+  os.write(reinterpret_cast<const char*>(data.feature_index.data()), data.feature_index.size() * sizeof(int));
 
-      if (wkbFlatten(poGeometry->getGeometryType()) == wkbLineString)
-      {
-        OGRLineString *poLineString = poGeometry->toLineString();
-
-        LineString line_string;
-        for (auto &poPoint : poLineString)
-        {
-          std::array<float, 3> p = manager.coord_transform_fwd(
-            poPoint.getX(),
-            poPoint.getY(),
-            base_elevation==0 ? poPoint.getZ() : base_elevation
-          );
-          line_string.push_back(p);
+  cache_write(os, uint32_t(data.columns.size()));
+  for (auto& column : data.columns) {
+    CacheType code;
+    cache_type(column.type, code);
+    cache_write_string(os, column.name);
+    cache_write(os, code);
+    cache_write(os, int32_t(column.field_index));
+    cache_write(os, uint8_t(column.is_dictionary));
+    if (column.is_dictionary) {
+      cache_write(os, uint64_t(column.dictionary.size()));
+      for (auto& str : column.dictionary) cache_write_string(os, str);
+    }
+    // a flag per value that is 0 for null values, followed by the values that
+    // are set as one array of their type
+    std::vector<uint8_t> is_set(column.values.size());
+    for (size_t i = 0; i < is_set.size(); ++i) is_set[i] = column.values[i].has_value();
+    cache_write_array(os, is_set);
+    CacheDateTimes date_times;
+    switch (code) {
+      case CacheType::BOOL: cache_write_array(os, cache_values<uint8_t, bool>(column.values)); break;
+      case CacheType::INT: cache_write_array(os, cache_values<int32_t, int>(column.values)); break;
+      case CacheType::FLOAT: cache_write_array(os, cache_values<float, float>(column.values)); break;
+      case CacheType::STRING: {
+        // the lengths of the strings and their concatenated characters
+        std::vector<uint64_t> lengths;
+        std::string chars;
+        for (auto& value : column.values) {
+          if (!value.has_value()) continue;
+          auto& str = std::any_cast<const std::string&>(value);
+          lengths.push_back(str.size());
+          chars += str;
         }
-        line_strings.push_back(line_string);
-        is_valid.push_back(bool(poGeometry->IsValid()));
+        cache_write_array(os, lengths);
+        cache_write_string(os, chars);
+        break;
+      }
+      case CacheType::DATE: date_times.push_values<Date>(column.values); break;
+      case CacheType::TIME: date_times.push_values<Time>(column.values); break;
+      case CacheType::DATETIME: date_times.push_values<DateTime>(column.values); break;
+    }
+    if (code == CacheType::DATE || code == CacheType::TIME || code == CacheType::DATETIME) {
+      cache_write_array(os, date_times.fields);
+      cache_write_array(os, date_times.seconds);
+    }
+  }
+}
+
+// returns false if the file is not a valid snapshot for this key
+inline bool read_layer_cache(std::istream& is, const std::string& key, OGRLayerData& data) {
+  char magic[sizeof(OGR_CACHE_MAGIC)];
+  if (!is.read(magic, sizeof(magic)) || std::memcmp(magic, OGR_CACHE_MAGIC, sizeof(magic)) != 0)
+    return false;
+  std::string file_key;
+  if (!cache_read_string(is, file_key) || file_key != key) return false;
+  if (!cache_read_string(is, data.layer_name)) return false;
+  if (!cache_read_string(is, data.geometry_type_name)) return false;
+  if (!cache_read_string(is, data.srs_wkt)) return false;
+  if (!cache_read_string(is, data.driver_name)) return false;
+
+  uint64_t n;
+  if (!cache_read(is, n)) return false;
+  data.polygons.resize(n);
+  for (auto& polygon : data.polygons) {
+    uint32_t n_rings;
+    if (!cache_read(is, n_rings)) return false;
+    polygon.resize(n_rings);
+    for (auto& ring : polygon)
+      if (!cache_read_points(is, ring)) return false;
+  }
+  if (!cache_read(is, n)) return false;
+  data.line_strings.resize(n);
+  for (auto& line_string : data.line_strings)
+    if (!cache_read_points(is, line_string)) return false;
+  if (!cache_read_points(is, data.points)) return false;
+  if (!cache_read(is, n)) return false;
+  data.meshes.resize(n);
+  data.mesh_labels.resize(n);
+  for (size_t m = 0; m < n; ++m) {
+    uint32_t n_polygons, n_labels;
+    if (!cache_read(is, n_polygons)) return false;
+    data.meshes[m].resize(n_polygons);
+    for (auto& polygon : data.meshes[m]) {
+      uint32_t n_rings;
+      if (!cache_read(is, n_rings)) return false;
+      polygon.resize(n_rings);
+      for (auto& ring : polygon)
+        if (!cache_read_points(is, ring)) return false;
+    }
+    if (!cache_read(is, n_labels)) return false;
+    data.mesh_labels[m].resize(n_labels);
+    if (!is.read(reinterpret_cast<char*>(data.mesh_labels[m].data()), n_labels * sizeof(int))) return false;
+  }
+
+  if (!cache_read(is, n)) return false;
+  data.wkt.resize(n);
+  for (auto& wkt : data.wkt)
+    if (!cache_read_string(is, wkt)) return false;
+  if (!cache_read(is, n)) return false;
+  data.area.resize(n);
+  if (!is.read(reinterpret_cast<char*>(data.area.data()), n * sizeof(float))) return false;
+  if (!cache_read(is, n)) return false;
+  data.is_valid.resize(n);
+  for (uint64_t i = 0; i < n; ++i) {
+    uint8_t v;
+    if (!cache_read(is, v)) return false;
+    data.is_valid[i] = v;
+  }
+  if (!cache_read(is, n)) return false;
+  data.n_features = n;
+  if (!cache_read(is, n)) return false;
+  data.feature_index.resize(n);
+  if (!is.read(reinterpret_cast<char*>(data.feature_index.data()), n * sizeof(int))) return false;
 
-        push_attributes(*poFeature, fieldNameMap);
+  uint32_t n_columns;
+  if (!cache_read(is, n_columns)) return false;
+  data.columns.clear();
+  data.columns.reserve(n_columns);
+  for (uint32_t c = 0; c < n_columns; ++c) {
+    std::string name;
+    CacheType code;
+    int32_t field_index;
+    uint8_t is_dictionary;
+    if (!cache_read_string(is, name) || !cache_read(is, code) || !cache_read(is, field_index) || !cache_read(is, is_dictionary))
+      return false;
+    if (code > CacheType::DATETIME) return false;
+    data.columns.push_back(OGRAttributeColumn{name, cache_type_index(code), field_index});
+    auto& column = data.columns.back();
+    column.is_dictionary = is_dictionary;
+    if (is_dictionary) {
+      if (!cache_read(is, n)) return false;
+      column.dictionary.resize(n);
+      for (auto& str : column.dictionary)
+        if (!cache_read_string(is, str)) return false;
+    }
+    // the values are read one array at a time, and then distributed over the
+    // rows that are set
+    std::vector<uint8_t> is_set;
+    if (!cache_read_array(is, is_set)) return false;
+    size_t n_set = std::count_if(is_set.begin(), is_set.end(), [](uint8_t v) { return v != 0; });
+    auto& values = column.values;
+    values.resize(is_set.size());
+    auto fill = [&](auto value) {
+      for (size_t i = 0; i < is_set.size(); ++i) {
+        if (is_set[i]) values[i] = value();
       }
-      else if (wkbFlatten(poGeometry->getGeometryType()) == wkbPolygon)
-      {
-        OGRPolygon *poPolygon = poGeometry->toPolygon();
+    };
+    switch (code) {
+      case CacheType::BOOL: {
+        std::vector<uint8_t> v;
+        if (!cache_read_array(is, v) || v.size() != n_set) return false;
+        size_t k = 0;
+        fill([&]() { return bool(v[k++]); });
+        break;
+      }
+      case CacheType::INT: {
+        std::vector<int32_t> v;
+        if (!cache_read_array(is, v) || v.size() != n_set) return false;
+        size_t k = 0;
+        fill([&]() { return int(v[k++]); });
+        break;
+      }
+      case CacheType::FLOAT: {
+        std::vector<float> v;
+        if (!cache_read_array(is, v) || v.size() != n_set) return false;
+        size_t k = 0;
+        fill([&]() { return v[k++]; });
+        break;
+      }
+      case CacheType::STRING: {
+        std::vector<uint64_t> lengths;
+        std::string chars;
+        if (!cache_read_array(is, lengths) || lengths.size() != n_set || !cache_read_string(is, chars)) return false;
+        uint64_t total = 0;
+        for (auto length : lengths) total += length;
+        if (total != chars.size()) return false;
+        size_t k = 0, offset = 0;
+        fill([&]() {
+          auto length = lengths[k++];
+          offset += length;
+          return chars.substr(offset - length, length);
+        });
+        break;
+      }
+      default: {
+        CacheDateTimes date_times;
+        if (!cache_read_array(is, date_times.fields) || !cache_read_array(is, date_times.seconds) || !date_times.holds(code, n_set))
+          return false;
+        if (code == CacheType::DATE) fill([&]() { return date_times.date(); });
+        else if (code == CacheType::TIME) fill([&]() { return date_times.time(); });
+        else fill([&]() { return date_times.date_time(); });
+      }
+    }
+  }
+  return true;
+}
 
-        read_polygon(poPolygon);
-        
-        area.push_back(float(poPolygon->get_Area()));
-        is_valid.push_back(bool(poPolygon->IsValid()));
+/// 64 bit FNV-1a hash, which unlike std::hash is the same for every standard
+/// library and build, so snapshot file names stay valid
+inline uint64_t fnv1a_hash(const std::string& str) {
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char c : str) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
 
-        push_attributes(*poFeature, fieldNameMap);
+std::string OGRLoaderNode::cache_file_key(const OGRSource& source)
+{
+  // only regular files are cached, their size and modification time tell if
+  // they have changed
+  std::error_code ec;
+  fs::path path(source.path);
+  if (!fs::is_regular_file(path, ec)) return "";
+  auto size = fs::file_size(path, ec);
+  if (ec) return "";
+  auto mtime = fs::last_write_time(path, ec);
+  if (ec) return "";
 
-      } 
-      else if ( wkbFlatten(poGeometry->getGeometryType()) == wkbMultiPolygon ) 
-      {
-        OGRMultiPolygon *poMultiPolygon = poGeometry->toMultiPolygon();
-        for (auto poly_it = poMultiPolygon->begin(); poly_it != poMultiPolygon->end(); ++poly_it) {
-          read_polygon(*poly_it);
-        
-          area.push_back(float((*poly_it)->get_Area()));
-          is_valid.push_back(bool((*poly_it)->IsValid()));
-
-          push_attributes(*poFeature, fieldNameMap);
+  std::stringstream key;
+  key << fs::absolute(path, ec).string() << "\n"
+      << size << "\n"
+      << mtime.time_since_epoch().count() << "\n"
+      << source.layer_name << "\n"
+      << (source.fallback_to_id ? layer_id : -1) << "\n"
+      << cache_key_;
+  return key.str();
+}
+
+std::string OGRLoaderNode::cache_file_path(const std::string& key)
+{
+  std::stringstream name;
+  name << std::hex << std::setw(16) << std::setfill('0') << fnv1a_hash(key) << ".gfcache";
+  return (fs::path(manager.substitute_globals(cache_dir_)) / name.str()).string();
+}
+
+bool OGRLoaderNode::load_cache(const std::string& key, OGRLayerData& data)
+{
+  std::ifstream f(cache_file_path(key), std::ios::binary);
+  if (!f.is_open()) return false;
+  OGRLayerData cached;
+  if (!read_layer_cache(f, key, cached)) return false;
+  data = std::move(cached);
+  return true;
+}
+
+void OGRLoaderNode::save_cache(const std::string& key, const OGRLayerData& data)
+{
+  // write to a temporary file first so that other processes never see a
+  // partially written snapshot
+  auto path = cache_file_path(key);
+  std::stringstream suffix;
+  suffix << ".tmp" << std::this_thread::get_id();
+  auto tmp_path = path + suffix.str();
+  {
+    std::ofstream f(tmp_path, std::ios::binary);
+    if (!f.is_open()) {
+      std::cout << "Could not write cache file " << tmp_path << "\n";
+      return;
+    }
+    write_layer_cache(f, key, data);
+    if (!f) {
+      std::cout << "Could not write cache file " << tmp_path << "\n";
+      f.close();
+      fs::remove(tmp_path);
+      return;
+    }
+  }
+  std::error_code ec;
+  fs::rename(tmp_path, path, ec);
+  if (ec) fs::remove(tmp_path, ec);
+}
+
+template <typename Points> void OGRLoaderNode::transform_fwd(const std::vector<arr3d>& points, Points& out)
+{
+  // the base_elevation check is hoisted out of the per vertex loop
+  out.reserve(out.size() + points.size());
+  if (base_elevation == 0) {
+    for (auto& p : points) out.push_back(manager.coord_transform_fwd(p[0], p[1], p[2]));
+  } else {
+    for (auto& p : points) out.push_back(manager.coord_transform_fwd(p[0], p[1], base_elevation));
+  }
+}
+
+void OGRLoaderNode::push_layer_data(OGRLayerData& data)
+{
+  auto &linear_rings = vector_output("linear_rings");
+  auto &line_strings = vector_output("line_strings");
+  auto &wkt = vector_output("wkt");
+  auto &is_valid = vector_output("is_valid");
+  auto &area = vector_output("area");
+  auto &feature_index = vector_output("feature_index");
+
+  std::cout << "Layer '" << data.layer_name << "' geometry type: " << data.geometry_type_name << "\n";
+  if (data.n_degenerate)
+    std::cout << "Skipped " << data.n_degenerate << " polygon(s) with less than 3 distinct exterior ring points in layer '" << data.layer_name << "'\n";
+  // consecutive layers usually share their CRS, the transformation is only
+  // set up again when it changes
+  if (data.srs_wkt.size() && data.srs_wkt != pushed_srs_wkt_) {
+    manager.set_fwd_crs_transform(data.srs_wkt.c_str());
+    pushed_srs_wkt_ = data.srs_wkt;
+  }
+
+  for (auto& polygon : data.polygons) {
+    LinearRing gf_polygon;
+    for (size_t r = 0; r < polygon.size(); ++r) {
+      if (r == 0) {
+        transform_fwd(polygon[r], gf_polygon);
+      } else {
+        gf_polygon.interior_rings().emplace_back();
+        transform_fwd(polygon[r], gf_polygon.interior_rings().back());
+      }
+    }
+    linear_rings.push_back(gf_polygon);
+  }
+  for (auto& ls : data.line_strings) {
+    LineString line_string;
+    transform_fwd(ls, line_string);
+    line_strings.push_back(line_string);
+  }
+  if (data.meshes.size()) {
+    auto &meshes = vector_output("meshes");
+    auto &triangle_collections = vector_output("triangle_collections");
+    for (size_t m = 0; m < data.meshes.size(); ++m) {
+      Mesh mesh;
+      TriangleCollection triangles;
+      bool all_triangles = true;
+      auto& labels = data.mesh_labels[m];
+      for (size_t k = 0; k < data.meshes[m].size(); ++k) {
+        auto& polygon = data.meshes[m][k];
+        LinearRing ring;
+        transform_fwd(polygon[0], ring);
+        for (size_t r = 1; r < polygon.size(); ++r) {
+          ring.interior_rings().emplace_back();
+          transform_fwd(polygon[r], ring.interior_rings().back());
+        }
+        if (polygon.size() == 1 && ring.size() == 3) {
+          triangles.push_back({ring[0], ring[1], ring[2]});
+        } else {
+          all_triangles = false;
+        }
+        mesh.push_polygon(ring, labels.size() ? labels[k] : 0);
+      }
+      // only meshes that consist of triangles have a TriangleCollection
+      if (!all_triangles) triangles.clear();
+      meshes.push_back(mesh);
+      triangle_collections.push_back(triangles);
+    }
+  }
+  bool point_layer = !data.points.empty();
+  if (point_layer) {
+    if (data.polygons.size() || data.line_strings.size())
+      throw(gfIOError("Layer '" + data.layer_name + "' has both points and other geometry types, this is not supported"));
+    size_t offset = points_.size();
+    transform_fwd(data.points, points_);
+    push_point_attributes(data, offset);
+  }
+  for (auto& v : data.wkt) wkt.push_back(v);
+  for (auto v : data.is_valid) is_valid.push_back(bool(v));
+  for (auto v : data.area) area.push_back(v);
+  if (compute_feature_index_) {
+    for (auto f : data.feature_index) feature_index.push_back(int(feature_rows_ + f));
+  }
+  feature_rows_ += data.n_features;
+  // the attributes of points are stored in the PointCollection
+  if (point_layer) return;
+
+  // merge the attribute columns into the unified schema, columns that are not
+  // present in all sources are filled up with null values
+  size_t n_rows = data.polygons.size() + data.line_strings.size() + data.meshes.size();
+  if (!data.columns.empty())
+    n_rows = data.columns[0].values.size();
+  else if (attributes_per_feature_ || ignore_geometry_)
+    n_rows = data.n_features;
+  for (auto& column : data.columns) {
+    auto it = attribute_terms_.find(column.name);
+    if (it == attribute_terms_.end()) {
+      auto& term = poly_output("attributes").add_vector(column.name, column.type);
+      for (size_t i = 0; i < attribute_rows_; ++i) term.push_back_any(std::any());
+      it = attribute_terms_.emplace(column.name, &term).first;
+      if (column.is_dictionary) {
+        dictionary_terms_[column.name] = &poly_output("attribute_dictionaries").add_vector(column.name, typeid(std::string));
+        dictionary_codes_[column.name];
+      }
+    }
+    auto term = it->second;
+    auto dict_it = dictionary_codes_.find(column.name);
+    if (column.is_dictionary || dict_it != dictionary_codes_.end()) {
+      // Dictionary codes are per layer, they are mapped to the codes of the
+      // dictionary output. Columns that are dictionary encoded in only some
+      // of the layers are expanded to strings or encoded here.
+      if (dict_it == dictionary_codes_.end()) {
+        for (auto& v : column.values) {
+          if (v.has_value()) v = column.dictionary[std::any_cast<int>(v)];
         }
+        column.type = typeid(std::string);
       } else {
-        throw gfIOError("Unsupported geometry type\n");
+        auto dictionary_term = dictionary_terms_[column.name];
+        auto intern = [&](const std::string& str) {
+          auto code_it = dict_it->second.find(str);
+          if (code_it != dict_it->second.end()) return code_it->second;
+          int code = int(dictionary_term->size());
+          dictionary_term->push_back_any(std::any(str));
+          dict_it->second.emplace(str, code);
+          return code;
+        };
+        if (column.is_dictionary) {
+          std::vector<int> codes;
+          for (auto& str : column.dictionary) codes.push_back(intern(str));
+          for (auto& v : column.values) {
+            if (v.has_value()) term->push_back_any(codes[std::any_cast<int>(v)]);
+            else term->push_back_any(std::any());
+          }
+        } else {
+          for (auto& v : column.values) {
+            auto str = convert_attribute(v, typeid(std::string));
+            if (str.has_value()) term->push_back_any(intern(std::any_cast<const std::string&>(str)));
+            else term->push_back_any(std::any());
+          }
+        }
+        column.values.clear();
+        continue;
+      }
+    }
+    if (term->accepts_type(column.type)) {
+      for (auto& v : column.values) term->push_back_any(std::move(v));
+    } else {
+      std::cout << "Attribute '" << column.name << "' has a different type in layer '" << data.layer_name << "', converting values\n";
+      for (auto& v : column.values) term->push_back_any(convert_attribute(v, term->get_type()));
+    }
+    column.values.clear();
+  }
+  attribute_rows_ += n_rows;
+  for (auto& [name, term] : attribute_terms_) {
+    for (size_t i = term->size(); i < attribute_rows_; ++i) term->push_back_any(std::any());
+  }
+}
+
+void OGRLoaderNode::push_point_attributes(OGRLayerData& data, size_t offset)
+{
+  // one typed value per point, null values become false, 0, NaN or an empty string
+  auto& attributes = points_.get_attributes();
+  size_t n_points = data.points.size();
+  for (auto& column : data.columns) {
+    bool per_point = column.values.size() == n_points;
+    std::type_index type = column.is_dictionary ? typeid(std::string) : column.type;
+    auto it = attributes.find(column.name);
+    if (it == attributes.end()) {
+      attribute_vec vec;
+      if (type == typeid(bool)) vec = vec1b(offset);
+      else if (type == typeid(int)) vec = vec1i(offset);
+      else if (type == typeid(float)) vec = vec1f(offset, std::numeric_limits<float>::quiet_NaN());
+      else vec = vec1s(offset);
+      it = attributes.emplace(column.name, std::move(vec)).first;
+    }
+    std::visit([&](auto& vec) {
+      using T = typename std::decay_t<decltype(vec)>::value_type;
+      vec.reserve(offset + n_points);
+      for (size_t i = 0; i < n_points; ++i) {
+        std::any v = column.values[per_point ? i : data.feature_index[i]];
+        if (column.is_dictionary && v.has_value()) v = column.dictionary[std::any_cast<int>(v)];
+        v = convert_attribute(v, typeid(T));
+        if (v.has_value()) vec.push_back(std::any_cast<T>(v));
+        else if constexpr (std::is_same_v<T, float>) vec.push_back(std::numeric_limits<float>::quiet_NaN());
+        else vec.push_back(T());
+      }
+    }, it->second);
+    column.values.clear();
+  }
+  // attributes that this layer does not have
+  for (auto& [name, vec] : attributes) {
+    std::visit([this](auto& v) { v.resize(points_.size()); }, vec);
+  }
+}
+
+void OGRLoaderNode::reset_stream()
+{
+  stream_pending_.reset();
+  stream_layer_ = nullptr;
+  stream_ds_.reset();
+  stream_sources_.clear();
+  stream_found_.clear();
+  stream_source_ = 0;
+  stream_rows_ = 0;
+}
+
+bool OGRLoaderNode::read_stream_batch(const std::string& attribute_filter, OGRGeometry* spatial_filter)
+{
+  // open the next source that has the requested layer
+  while (stream_layer_ == nullptr && stream_source_ < stream_sources_.size()) {
+    stream_schema_ = OGRLayerData();
+    stream_layer_ = open_source(stream_sources_[stream_source_], attribute_filter, spatial_filter, stream_ds_, stream_schema_);
+    if (stream_layer_ == nullptr) {
+      ++stream_source_;
+    } else {
+      stream_found_[stream_source_] = true;
+      // only a count that the driver has without a scan, -1 if it has none,
+      // the stream ends when the layer has no more features
+      stream_feature_count_ = stream_layer_->GetFeatureCount(FALSE);
+      stream_features_read_ = 0;
+    }
+  }
+  if (stream_layer_ == nullptr) return true;
+
+  // a batch never spans multiple layers, so it has a single schema and CRS
+  OGRLayerData data = stream_schema_;
+  if (batch_size_ > 0)
+    reserve_layer_data(data, batch_size_);
+  size_t max_features = size_t(std::max(0, batch_size_));
+  size_t max_bytes = size_t(std::max(0.f, batch_size_mb_) * 1024 * 1024);
+  size_t n_features = 0, n_bytes = 0;
+  bool layer_done = false;
+  while (true) {
+    OGRFeatureUniquePtr poFeature = stream_pending_ ? std::move(stream_pending_) : OGRFeatureUniquePtr(stream_layer_->GetNextFeature());
+    if (poFeature == nullptr) {
+      layer_done = true;
+      break;
+    }
+    if ((max_features && n_features >= max_features) || (max_bytes && n_bytes >= max_bytes)) {
+      // keep this feature for the next batch
+      stream_pending_ = std::move(poFeature);
+      break;
+    }
+    // rough estimate of the memory taken by this feature
+    auto poGeometry = poFeature->GetGeometryRef();
+    n_bytes += (poGeometry ? poGeometry->WkbSize() : 0) + data.columns.size() * sizeof(std::any);
+    read_feature(poFeature.get(), data);
+    ++n_features;
+  }
+  stream_features_read_ += n_features;
+  std::cout << "Read batch of " << n_features << " features from '" << data.layer_name << "'\n";
+  filter_shard_rows(data);
+  push_layer_data(data);
+  stream_rows_ += feature_rows_;
+
+  if (layer_done) {
+    stream_layer_ = nullptr;
+    stream_ds_.reset();
+    ++stream_source_;
+  }
+  return layer_done && stream_source_ >= stream_sources_.size();
+}
+
+void OGRLoaderNode::read_sources(const std::vector<OGRSource>& sources, const std::string& attribute_filter, OGRGeometry* spatial_filter, const std::function<void(size_t, OGRLayerData&)>& on_layer)
+{
+  // Every source is opened and decoded on its own thread with its own
+  // GDALDataset. The decoded layers are handed to on_layer in the order of the
+  // sources on this thread, since the coordinate transformation of the
+  // manager is not thread safe.
+  size_t n_threads = n_threads_ > 0 ? size_t(n_threads_) : std::max(1u, std::thread::hardware_concurrency());
+  // with a single source the threads are used to decode its features instead
+  decode_threads_ = 0;
+  if (parallel_decode_ && !use_arrow_stream_ && sources.size() == 1 && n_threads > 1)
+    decode_threads_ = n_threads - 1;
+  n_threads = std::min(n_threads, sources.size());
+
+  std::vector<OGRLayerData> layers(sources.size());
+  std::vector<std::promise<void>> promises(sources.size());
+  std::atomic<size_t> next_source{0};
+  auto worker = [&]() {
+    size_t k;
+    while ((k = next_source++) < sources.size()) {
+      try {
+        read_source(sources[k], attribute_filter, spatial_filter, layers[k]);
+        promises[k].set_value();
+      } catch (...) {
+        promises[k].set_exception(std::current_exception());
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < n_threads; ++t) threads.emplace_back(worker);
+
+  std::exception_ptr error;
+  try {
+    for (size_t k = 0; k < sources.size(); ++k) {
+      promises[k].get_future().get();
+      on_layer(k, layers[k]);
+    }
+  } catch (...) {
+    // stop handing out new sources and wait for the running ones
+    next_source = sources.size();
+    error = std::current_exception();
+  }
+  for (auto& thread : threads) thread.join();
+  if (error) std::rethrow_exception(error);
+}
+
+bool OGRLoaderNode::push_memory_layers(const std::string& attribute_filter, OGRGeometry* spatial_filter)
+{
+  if (spatial_filter && ignore_geometry_) {
+    std::cout << "Cannot apply a spatial filter in memory without geometries, the filters are passed to OGR instead\n";
+    return false;
+  }
+  std::unique_ptr<OGRAttributeFilter> filter;
+  if (!attribute_filter.empty()) {
+    try {
+      filter = std::make_unique<OGRAttributeFilter>(attribute_filter);
+    } catch (const gfException& e) {
+      std::cout << e.what() << ", the filter is passed to OGR instead\n";
+      return false;
+    }
+  }
+
+  // select the rows of all layers before anything is pushed, so that nothing
+  // is pushed twice when a filter can not be evaluated
+  bool filter_is_box = !vector_input("spatial_filter").has_data();
+  std::vector<std::vector<bool>> selections(memory_layers_.size());
+  for (size_t k = 0; k < memory_layers_.size(); ++k) {
+    if (!filter_rows(memory_layers_[k], filter.get(), spatial_filter, filter_is_box, selections[k])) {
+      std::cout << "Cannot filter layer '" << memory_layers_[k].layer_name << "' in memory, the filters are passed to OGR instead\n";
+      return false;
+    }
+  }
+  for (size_t k = 0; k < memory_layers_.size(); ++k) {
+    auto data = select_rows(memory_layers_[k], selections[k]);
+    push_layer_data(data);
+  }
+  std::cout << "Filtered " << memory_layers_.size() << " layer(s) in memory\n";
+  return true;
+}
+
+void OGRLoaderNode::process()
+{
+  // the optional outputs are only computed when they are used
+  compute_wkt_ = force_optional_outputs_ || is_connected(vector_output("wkt"));
+  compute_area_ = force_optional_outputs_ || is_connected(vector_output("area"));
+  // the meshes have no per polygon rows that an area could line up with
+  if (read_meshes_ && compute_area_) {
+    if (is_connected(vector_output("area")))
+      std::cout << "The area output is not computed with read_meshes\n";
+    compute_area_ = false;
+  }
+  compute_feature_index_ = force_optional_outputs_ || is_connected(vector_output("feature_index"));
+  validity_check_ = ValidityCheck::OFF;
+  if (force_optional_outputs_ || is_connected(vector_output("is_valid")))
+    validity_check_ = ValidityCheck(std::clamp(validity_mode_, 0, 2));
+
+  if (dataset_pool_size_ > 0)
+    OGRDatasetPool::instance().set_capacity(size_t(dataset_pool_size_));
+
+  if (shard_count_ > 1) {
+    if (shard_index_ < 0 || shard_index_ >= shard_count_)
+      throw(gfException("shard_index must be between 0 and shard_count - 1"));
+    if (shard_spatial_ && ignore_geometry_)
+      throw(gfException("shard_spatial needs the geometries, it cannot be combined with ignore_geometry"));
+  }
+
+  auto attribute_filter = manager.substitute_globals(attribute_filter_);
+  auto spatial_filter = create_spatial_filter();
+
+  auto parse_field_list = [&](const std::string& param, vec1s& patterns) {
+    patterns.clear();
+    std::string field_list = manager.substitute_globals(param);
+    std::replace(field_list.begin(), field_list.end(), ',', ' ');
+    for (auto& pattern : split_string(field_list, " ")) {
+      if (!pattern.empty()) patterns.push_back(pattern);
+    }
+  };
+  parse_field_list(fields_, selected_fields_);
+  parse_field_list(dictionary_fields_, dictionary_fields_list_);
+
+  // the part of the cache key that is the same for every source
+  auto spatial_filter_wkt = spatial_filter ? spatial_filter->exportToWkt() : std::string();
+  auto make_cache_key = [&](const std::string& attribute_filter, const std::string& spatial_filter_wkt) {
+    std::stringstream key;
+    key << attribute_filter << "\n"
+        << spatial_filter_wkt << "\n"
+        << selected_fields_.size() << "\n";
+    for (auto& field : selected_fields_) key << field << "\n";
+    key << dictionary_fields_list_.size() << "\n";
+    for (auto& field : dictionary_fields_list_) key << field << "\n";
+    key << ignore_geometry_ << attributes_per_feature_ << read_meshes_ << output_fid_ << compute_wkt_ << compute_area_ << int(validity_check_) << "\n";
+    if (shard_count_ > 1)
+      key << shard_index_ << "/" << shard_count_ << (shard_spatial_ ? " spatial" : " fid");
+    return key.str();
+  };
+  cache_key_ = make_cache_key(attribute_filter, spatial_filter_wkt);
+  if (!cache_dir_.empty()) {
+    std::error_code ec;
+    fs::create_directories(manager.substitute_globals(cache_dir_), ec);
+  }
+
+  attribute_terms_.clear();
+  attribute_rows_ = 0;
+  feature_rows_ = 0;
+  points_ = PointCollection();
+  dictionary_codes_.clear();
+  dictionary_terms_.clear();
+  pushed_srs_wkt_.clear();
+
+  // streaming mode, every invocation emits the next batch of features
+  if (batch_size_ > 0 || batch_size_mb_ > 0) {
+    if (use_arrow_stream_)
+      std::cout << "use_arrow_stream is ignored in streaming mode\n";
+
+    // restart the stream when the input selection has changed, the cache key
+    // covers the filters (including the spatial_filter input), the fields and
+    // the decoding options
+    auto stream_key = manager.substitute_globals(filepath) + "\n" + manager.substitute_globals(layer_name_) + "\n" + cache_key_;
+    if (stream_key != stream_key_ || stream_sources_.empty()) {
+      reset_stream();
+      stream_key_ = stream_key;
+      stream_sources_ = list_sources();
+      if (stream_sources_.empty())
+        throw(gfException("No files found for " + manager.substitute_globals(filepath)));
+      stream_found_.assign(stream_sources_.size(), false);
+    }
+
+    bool end_of_stream = read_stream_batch(attribute_filter, spatial_filter.get());
+    if (end_of_stream) {
+      try {
+        check_layers_found(stream_sources_, stream_found_);
+      } catch (...) {
+        reset_stream();
+        throw;
       }
     }
+
+    float progress = 1;
+    if (!end_of_stream) {
+      progress = float(stream_source_);
+      if (stream_layer_ != nullptr && stream_feature_count_ > 0)
+        progress += std::min(1.f, float(stream_features_read_) / stream_feature_count_);
+      progress /= stream_sources_.size();
+    }
+    std::cout << "Stream progress: " << int(progress * 100) << "%\n";
+    output("end_of_stream").set(end_of_stream);
+    output("progress").set(progress);
+    output("shard_feature_count").set(int(stream_rows_));
+    if (points_.size()) output("points").set(points_);
+
+    // start from the beginning on the next invocation
+    if (end_of_stream) reset_stream();
+    return;
+  }
+
+  auto sources = list_sources();
+  if (sources.empty())
+    throw(gfException("No files found for " + manager.substitute_globals(filepath)));
+
+  // skipped sources have no layer name
+  std::vector<bool> found(sources.size(), false);
+  auto push_layer = [&](size_t k, OGRLayerData& layer) {
+    found[k] = !layer.layer_name.empty();
+    if (sources.size() > 1)
+      std::cout << "Read " << sources[k].path << "\n";
+    push_layer_data(layer);
+    layer = OGRLayerData();
+  };
+
+  bool pushed = false;
+  if (!keep_in_memory_) {
+    memory_key_.clear();
+    memory_layers_.clear();
+  } else {
+    // the layers in memory are read again when anything but the filters has
+    // changed, including the files themselves
+    std::stringstream key;
+    key << make_cache_key("", "") << base_elevation << "\n";
+    for (auto& source : sources)
+      key << source.path << "\n" << source.layer_name << "\n" << layer_id << "\n" << dataset_mtime(source.path).time_since_epoch().count() << "\n";
+    if (key.str() != memory_key_) {
+      memory_key_.clear();
+      memory_layers_.clear();
+      memory_layers_.resize(sources.size());
+      cache_key_ = make_cache_key("", "");
+      read_sources(sources, "", nullptr, [&](size_t k, OGRLayerData& layer) {
+        memory_layers_[k] = std::move(layer);
+      });
+      for (size_t k = 0; k < sources.size(); ++k) found[k] = !memory_layers_[k].layer_name.empty();
+      check_layers_found(sources, found);
+      memory_key_ = key.str();
+      cache_key_ = make_cache_key(attribute_filter, spatial_filter_wkt);
+    }
+    pushed = push_memory_layers(attribute_filter, spatial_filter.get());
+  }
+  if (!pushed) {
+    read_sources(sources, attribute_filter, spatial_filter.get(), push_layer);
+    check_layers_found(sources, found);
   }
-  // if (geometry_type == wkbLineString25D || geometry_type == wkbLineStringZM) {
+
+  output("end_of_stream").set(true);
+  output("progress").set(1.f);
+  output("shard_feature_count").set(int(feature_rows_));
+  if (points_.size()) output("points").set(points_);
+  if (shard_count_ > 1)
+    std::cout << "Read " << feature_rows_ << " features in shard " << shard_index_ << " of " << shard_count_ << "\n";
+
+  auto &linear_rings = vector_output("linear_rings");
+  auto &line_strings = vector_output("line_strings");
   if (line_strings.size() > 0)
   {
-    // output("line_strings").set(line_strings);
     std::cout << "pushed " << line_strings.size() << " line_string features...\n";
-    // } else if (geometry_type == wkbPolygon || geometry_type == wkbPolygon25D || geometry_type == wkbPolygonZM || geometry_type == wkbPolygonM) {
   }
   else if (linear_rings.size() > 0)
   {
-    // output("linear_rings").set(linear_rings);
     std::cout << "pushed " << linear_rings.size() << " linear_ring features...\n";
   }
+  else if (points_.size() > 0)
+  {
+    std::cout << "pushed " << points_.size() << " points...\n";
+  }
 }
 
 } // namespace geoflow::nodes::gdal
@@ -21,6 +21,19 @@
 #include <iomanip>
 #include <sstream>
 #include <filesystem>
+#include <cmath>
+#include <cstring>
+#include <cctype>
+#include <limits>
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <thread>
+
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,8,0)
+#include <ogr_recordbatch.h>
+#endif
 
 namespace fs = std::filesystem;
 
@@ -34,34 +47,234 @@ inline void create_field(OGRLayer* layer, const std::string& name, OGRFieldType
   }
 }
 
-OGRPolygon OGRWriterNode::create_polygon(const LinearRing& lr) {
-  OGRPolygon ogrpoly;
-  OGRLinearRing ogrring;
-  // set exterior ring
-  for (auto& g : lr) {
-    auto coord_t = manager.coord_transform_rev(g[0], g[1], g[2]);
-    ogrring.addPoint(coord_t[0],
-                     coord_t[1],
-                     coord_t[2]);
+template <typename Points> void OGRWriterNode::transform_rev(const Points& points, std::vector<arr3d>& result)
+{
+  result.resize(points.size());
+  size_t i = 0, n = points.size();
+  auto g = points.begin();
+  if (rev_offset_) {
+    // no CRS transformation, the vertices are only offset
+    auto& offset = *rev_offset_;
+    for (; i < n; ++i, ++g) result[i] = {double((*g)[0]) + offset[0], double((*g)[1]) + offset[1], double((*g)[2]) + offset[2]};
+    return;
+  }
+  // the coordinate transformation of the manager is not thread safe, it is
+  // locked per batch of vertices so that the worker threads interleave
+  while (i < n) {
+    std::lock_guard<std::mutex> lock(transform_mutex_);
+    for (size_t end = std::min(n, i + 256); i < end; ++i, ++g) result[i] = manager.coord_transform_rev((*g)[0], (*g)[1], (*g)[2]);
   }
-  ogrring.closeRings();
-  ogrpoly.addRing(&ogrring);
+}
 
-  // set interior rings
-  for (auto& iring : lr.interior_rings()) {
-    OGRLinearRing ogr_iring;
-    for (auto& g : iring) {
-      auto coord_t = manager.coord_transform_rev(g[0], g[1], g[2]);
-      ogr_iring.addPoint(coord_t[0],
-                         coord_t[1],
-                         coord_t[2]);
-    }
-    ogr_iring.closeRings();
-    ogrpoly.addRing(&ogr_iring);
+template <typename Points> void OGRWriterNode::set_points(const Points& points, OGRSimpleCurve& curve, bool close)
+{
+  // transform all vertices into contiguous x, y and z arrays and hand them to
+  // OGR in a single call. The features are built on multiple threads, each
+  // has its own buffers.
+  thread_local std::vector<arr3d> coords;
+  thread_local std::vector<double> xs, ys, zs;
+  transform_rev(points, coords);
+  size_t n = coords.size();
+  xs.resize(n + 1);
+  ys.resize(n + 1);
+  zs.resize(n + 1);
+  for (size_t i = 0; i < n; ++i) {
+    xs[i] = coords[i][0];
+    ys[i] = coords[i][1];
+    zs[i] = coords[i][2];
+  }
+  // equivalent of OGRLinearRing::closeRings()
+  if (close && n > 0 && (xs[0] != xs[n-1] || ys[0] != ys[n-1] || zs[0] != zs[n-1])) {
+    xs[n] = xs[0];
+    ys[n] = ys[0];
+    zs[n] = zs[0];
+    ++n;
+  }
+  curve.setPoints(int(n), xs.data(), ys.data(), zs.data());
+}
+
+/// Make a (reused) polygon have n_rings rings. Its rings are only replaced
+/// when their number changes, otherwise their point buffers are reused.
+inline void resize_rings(OGRPolygon& poly, size_t n_rings) {
+  size_t n = poly.getExteriorRing() ? size_t(poly.getNumInteriorRings()) + 1 : 0;
+  if (n == n_rings) return;
+  poly.empty();
+  for (size_t r = 0; r < n_rings; ++r) poly.addRingDirectly(new OGRLinearRing());
+}
+
+void OGRWriterNode::set_polygon(const LinearRing& lr, OGRPolygon& poly) {
+  auto& irings = lr.interior_rings();
+  resize_rings(poly, irings.size() + 1);
+  set_points(lr, *poly.getExteriorRing(), true);
+  for (size_t r = 0; r < irings.size(); ++r) {
+    set_points(irings[r], *poly.getInteriorRing(int(r)), true);
+  }
+  // the rings are 3D, empty rings that were added to the polygon were not
+  poly.set3D(TRUE);
+}
+
+void OGRWriterNode::set_polygon(const Triangle& triangle, OGRPolygon& poly) {
+  resize_rings(poly, 1);
+  set_points(triangle, *poly.getExteriorRing(), true);
+  poly.set3D(TRUE);
+}
+
+/// Geometries serialized as ISO WKB with Z coordinates, in the byte order of
+/// the host. The buffer is reused, so that serializing a geometry does not
+/// allocate once it has grown large enough. Only used by the Arrow batch
+/// writer, the feature by feature writer reuses pooled OGR geometries
+/// instead (see OGRFeaturePool).
+struct WKBBuffer {
+  std::vector<unsigned char> bytes;
+
+  void clear() { bytes.clear(); }
+  template <typename T> void append(T v) {
+    auto p = reinterpret_cast<const unsigned char*>(&v);
+    bytes.insert(bytes.end(), p, p + sizeof(T));
+  }
+  void append_point(const arr3d& p) {
+    append(p[0]);
+    append(p[1]);
+    append(p[2]);
+  }
+  // byte order and ISO type code of a geometry with Z
+  void header(OGRwkbGeometryType type) {
+    bytes.push_back(CPL_IS_LSB ? wkbNDR : wkbXDR);
+    append(uint32_t(type) + 1000);
+  }
+  // reserves a count that is filled in by set_count() once it is known
+  size_t reserve_count() {
+    append(uint32_t(0));
+    return bytes.size() - sizeof(uint32_t);
+  }
+  void set_count(size_t pos, uint32_t n) {
+    std::memcpy(bytes.data() + pos, &n, sizeof(n));
+  }
+};
+
+template <typename Points> void OGRWriterNode::append_wkb_ring(const Points& points, WKBBuffer& wkb)
+{
+  // same as set_points(), but the transformed vertices are written straight
+  // into the WKB buffer
+  thread_local std::vector<arr3d> coords;
+  transform_rev(points, coords);
+  bool close = coords.size() && coords.front() != coords.back();
+  wkb.append(uint32_t(coords.size() + close));
+  for (auto& c : coords) wkb.append_point(c);
+  if (close) wkb.append_point(coords.front());
+}
+
+void OGRWriterNode::append_wkb(const LinearRing& lr, WKBBuffer& wkb) {
+  wkb.header(wkbPolygon);
+  wkb.append(uint32_t(lr.interior_rings().size() + 1));
+  append_wkb_ring(lr, wkb);
+  for (auto& iring : lr.interior_rings()) append_wkb_ring(iring, wkb);
+}
+
+void OGRWriterNode::append_wkb(const Triangle& triangle, WKBBuffer& wkb) {
+  wkb.header(wkbPolygon);
+  wkb.append(uint32_t(1));
+  append_wkb_ring(triangle, wkb);
+}
+
+void OGRWriterNode::append_wkb(const LineString& ls, WKBBuffer& wkb) {
+  thread_local std::vector<arr3d> coords;
+  transform_rev(ls, coords);
+  wkb.header(wkbLineString);
+  wkb.append(uint32_t(coords.size()));
+  for (auto& c : coords) wkb.append_point(c);
+}
+
+template <typename Polygons> void OGRWriterNode::append_wkb_multipolygon(const Polygons& polygons, WKBBuffer& wkb) {
+  wkb.header(wkbMultiPolygon);
+  size_t count = wkb.reserve_count();
+  uint32_t n = 0;
+  for (auto& polygon : polygons) {
+    append_wkb(polygon, wkb);
+    ++n;
   }
-  return ogrpoly;
+  wkb.set_count(count, n);
+}
+
+/// Take over the geometry of a pooled feature if it has the given type, so
+/// that its parts and point buffers are reused. Otherwise a new geometry is
+/// created.
+template <typename T> inline T* reuse_geometry(OGRFeature* feature, OGRwkbGeometryType type) {
+  OGRGeometry* geometry = feature->StealGeometry();
+  if (geometry && wkbFlatten(geometry->getGeometryType()) == type) return static_cast<T*>(geometry);
+  delete geometry;
+  return new T();
+}
+
+/// Polygon k of a reused MultiPolygon, appended if it does not exist yet
+inline OGRPolygon* multipolygon_part(OGRMultiPolygon* multipoly, int k) {
+  if (k < multipoly->getNumGeometries()) return multipoly->getGeometryRef(k);
+  auto poly = new OGRPolygon();
+  multipoly->addGeometryDirectly(poly);
+  return poly;
 }
 
+/// Drop the polygons of a reused MultiPolygon after the first n
+inline void truncate_multipolygon(OGRMultiPolygon* multipoly, int n) {
+  while (multipoly->getNumGeometries() > n) multipoly->removeGeometry(multipoly->getNumGeometries() - 1);
+  multipoly->set3D(TRUE);
+}
+
+/// Copy the field values of a feature to another feature of the same layer
+inline void copy_fields(const OGRFeature& src, OGRFeature& dst) {
+  for (int i = 0; i < src.GetFieldCount(); ++i) {
+    if (src.IsFieldSetAndNotNull(i)) dst.SetField(i, src.GetRawFieldRef(i));
+    else if (src.IsFieldNull(i)) dst.SetFieldNull(i);
+  }
+}
+
+/// Features of one layer that are reused instead of being created and
+/// destroyed for every written feature. A feature that is returned to the pool
+/// keeps its geometry, to be reused by reuse_geometry(). Thread safe, the
+/// features are built on the worker threads and returned by the writer.
+class OGRFeaturePool {
+  OGRFeatureDefn* defn_;
+  std::mutex mutex_;
+  std::vector<OGRFeature*> free_;
+  // bounds the memory that is held by the geometries of idle features
+  static constexpr size_t capacity_ = 1024;
+
+public:
+  explicit OGRFeaturePool(OGRFeatureDefn* defn) : defn_(defn) {}
+  ~OGRFeaturePool() {
+    for (auto feature : free_) OGRFeature::DestroyFeature(feature);
+  }
+  // a feature without fields and FID
+  OGRFeature* get() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!free_.empty()) {
+        auto feature = free_.back();
+        free_.pop_back();
+        return feature;
+      }
+    }
+    return OGRFeature::CreateFeature(defn_);
+  }
+  void put(OGRFeature* feature) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (free_.size() >= capacity_) feature = nullptr;
+    }
+    if (feature == nullptr) return;
+    auto geometry = feature->StealGeometry();
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,5,0)
+    feature->Reset();
+#else
+    for (int i = 0; i < feature->GetFieldCount(); ++i) feature->UnsetField(i);
+    feature->SetFID(OGRNullFID);
+#endif
+    feature->SetGeometryDirectly(geometry);
+    std::lock_guard<std::mutex> lock(mutex_);
+    free_.push_back(feature);
+  }
+};
+
 void OGRWriterNode::on_receive(gfMultiFeatureInputTerminal& it) {
   key_options.clear();
   if(&it == &poly_input("attributes")) {
@@ -84,6 +297,611 @@ inline std::string find_and_replace(std::string str, std::string from, std::stri
   return str;
 }
 
+// Setters of the attribute write plan, one per attribute type
+inline void set_bool_field(OGRFeature& f, const OGRAttributeWriter& w, const std::any& v) {
+  f.SetField(w.field, int(std::any_cast<const bool&>(v)));
+}
+inline void set_float_field(OGRFeature& f, const OGRAttributeWriter& w, const std::any& v) {
+  f.SetField(w.field, double(std::any_cast<const float&>(v)));
+}
+inline void set_int_field(OGRFeature& f, const OGRAttributeWriter& w, const std::any& v) {
+  f.SetField(w.field, std::any_cast<const int&>(v));
+}
+inline void set_string_field(OGRFeature& f, const OGRAttributeWriter& w, const std::any& v) {
+  f.SetField(w.field, std::any_cast<const std::string&>(v).c_str());
+}
+inline void set_dictionary_field(OGRFeature& f, const OGRAttributeWriter& w, const std::any& v) {
+  f.SetField(w.field, w.dictionary->get<const std::string&>(std::any_cast<const int&>(v)).c_str());
+}
+inline void set_date_field(OGRFeature& f, const OGRAttributeWriter& w, const std::any& v) {
+  auto& val = std::any_cast<const Date&>(v);
+  f.SetField(w.field, val.year, val.month, val.day);
+}
+inline void set_time_field(OGRFeature& f, const OGRAttributeWriter& w, const std::any& v) {
+  auto& val = std::any_cast<const Time&>(v);
+  f.SetField(w.field, 0, 0, 0, val.hour, val.minute, val.second, val.timeZone);
+}
+inline void set_datetime_field(OGRFeature& f, const OGRAttributeWriter& w, const std::any& v) {
+  auto& val = std::any_cast<const DateTime&>(v);
+  f.SetField(w.field, val.date.year, val.date.month, val.date.day, val.time.hour, val.time.minute, val.time.second, val.time.timeZone);
+}
+
+std::vector<OGRAttributeWriter> OGRWriterNode::attribute_write_plan(const std::unordered_map<std::string, size_t>& attr_id_map, const std::unordered_map<std::string, gfSingleFeatureOutputTerminal*>& dictionaries)
+{
+  using Type = OGRAttributeWriter::Type;
+  std::vector<OGRAttributeWriter> plan;
+  for (auto& term : poly_input("attributes").sub_terminals()) {
+    auto tname = term->get_full_name();
+    // skip if not added by user in output_attribute_names
+    if (only_output_mapped_attrs_ && output_attribute_names.find(tname) == output_attribute_names.end()) continue;
+    auto field = attr_id_map.find(tname);
+    if (field == attr_id_map.end()) continue;
+
+    OGRAttributeWriter writer{Type::BOOL, term, int(field->second)};
+    if (term->accepts_type(typeid(bool))) {
+      writer.set = set_bool_field;
+    } else if (term->accepts_type(typeid(float))) {
+      writer.type = Type::FLOAT;
+      writer.set = set_float_field;
+    } else if (term->accepts_type(typeid(int)) && dictionaries.count(tname)) {
+      writer.type = Type::DICTIONARY;
+      writer.dictionary = dictionaries.at(tname);
+      writer.set = set_dictionary_field;
+    } else if (term->accepts_type(typeid(int))) {
+      writer.type = Type::INT;
+      writer.set = set_int_field;
+    } else if (term->accepts_type(typeid(std::string))) {
+      writer.type = Type::STRING;
+      writer.set = set_string_field;
+    } else if (term->accepts_type(typeid(Date))) {
+      writer.type = Type::DATE;
+      writer.set = set_date_field;
+    } else if (term->accepts_type(typeid(Time))) {
+      writer.type = Type::TIME;
+      writer.set = set_time_field;
+    } else if (term->accepts_type(typeid(DateTime))) {
+      writer.type = Type::DATETIME;
+      writer.set = set_datetime_field;
+    } else {
+      continue;
+    }
+    plan.push_back(writer);
+  }
+  return plan;
+}
+
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,8,0)
+
+/// Days since 1970-01-01 of a civil date
+inline int32_t days_from_date(const Date& d) {
+  int y = d.year - (d.month <= 2);
+  int era = (y >= 0 ? y : y - 399) / 400;
+  unsigned yoe = unsigned(y - era * 400);
+  unsigned doy = (153 * (d.month + (d.month > 2 ? -3 : 9)) + 2) / 5 + d.day - 1;
+  unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + int32_t(doe) - 719468;
+}
+
+inline int64_t time_ms(const Time& t) {
+  return (t.hour * 3600 + t.minute * 60) * int64_t(1000) + int64_t(std::lround(t.second * 1000));
+}
+
+/// A column of a record batch for OGRLayer::WriteArrowBatch, in the Arrow C
+/// data interface. The column owns its buffers, the release callbacks of the
+/// exported structs only mark them as released.
+struct ArrowBatchColumn {
+  enum Kind { FIXED, BOOL, BINARY } kind;
+  std::string name;
+  std::string format;
+  // width of FIXED values in bytes
+  size_t width = 0;
+  // Arrow encoded schema metadata, empty if there is none
+  std::string metadata;
+
+  std::vector<uint8_t> validity;
+  // FIXED values, or the bitmap of a BOOL column
+  std::vector<uint8_t> values;
+  std::vector<int32_t> offsets = {0};
+  std::string data;
+  int64_t length = 0;
+  int64_t null_count = 0;
+
+  const void* buffers[3];
+  ArrowSchema schema;
+  ArrowArray array;
+
+  ArrowBatchColumn(Kind kind, std::string name, std::string format, size_t width = 0)
+    : kind(kind), name(std::move(name)), format(std::move(format)), width(width) {}
+
+  void clear() {
+    validity.clear();
+    values.clear();
+    offsets.assign(1, 0);
+    data.clear();
+    length = 0;
+    null_count = 0;
+  }
+  void set_bit(std::vector<uint8_t>& bitmap, bool bit) {
+    if (length % 8 == 0) bitmap.push_back(0);
+    if (bit) bitmap.back() |= uint8_t(1 << (length % 8));
+  }
+  void append_null() {
+    set_bit(validity, false);
+    ++null_count;
+    if (kind == FIXED) values.resize(values.size() + width, 0);
+    else if (kind == BOOL) set_bit(values, false);
+    else offsets.push_back(int32_t(data.size()));
+    ++length;
+  }
+  template <typename T> void append(T v) {
+    set_bit(validity, true);
+    auto bytes = reinterpret_cast<const uint8_t*>(&v);
+    values.insert(values.end(), bytes, bytes + sizeof(T));
+    ++length;
+  }
+  void append_bool(bool v) {
+    set_bit(validity, true);
+    set_bit(values, v);
+    ++length;
+  }
+  // whether size more bytes still fit in the int32 offsets
+  bool fits(size_t size) const {
+    return data.size() + size <= size_t(std::numeric_limits<int32_t>::max());
+  }
+  void append_bytes(const char* bytes, size_t size) {
+    if (!fits(size))
+      throw(gfException("Value of " + std::to_string(size) + " bytes does not fit in Arrow batch column " + name));
+    set_bit(validity, true);
+    data.append(bytes, size);
+    offsets.push_back(int32_t(data.size()));
+    ++length;
+  }
+
+  static void release_schema(ArrowSchema* schema) { schema->release = nullptr; }
+  static void release_array(ArrowArray* array) { array->release = nullptr; }
+
+  void export_column() {
+    schema = ArrowSchema();
+    schema.format = format.c_str();
+    schema.name = name.c_str();
+    schema.metadata = metadata.empty() ? nullptr : metadata.data();
+    schema.flags = ARROW_FLAG_NULLABLE;
+    schema.release = release_schema;
+
+    buffers[0] = null_count ? validity.data() : nullptr;
+    buffers[1] = kind == BINARY ? static_cast<const void*>(offsets.data()) : static_cast<const void*>(values.data());
+    buffers[2] = data.data();
+    array = ArrowArray();
+    array.length = length;
+    array.null_count = null_count;
+    array.n_buffers = kind == BINARY ? 3 : 2;
+    array.buffers = buffers;
+    array.release = release_array;
+  }
+};
+
+/// Arrow schema metadata with a single key and value
+inline std::string arrow_metadata(const std::string& key, const std::string& value) {
+  std::string metadata;
+  auto append_int = [&metadata](int32_t v) {
+    metadata.append(reinterpret_cast<const char*>(&v), sizeof(v));
+  };
+  append_int(1);
+  append_int(int32_t(key.size()));
+  metadata += key;
+  append_int(int32_t(value.size()));
+  metadata += value;
+  return metadata;
+}
+
+inline void release_arrow_batch_schema(ArrowSchema* schema) {
+  for (int64_t i = 0; i < schema->n_children; ++i) {
+    if (schema->children[i]->release) schema->children[i]->release(schema->children[i]);
+  }
+  schema->release = nullptr;
+}
+inline void release_arrow_batch_array(ArrowArray* array) {
+  for (int64_t i = 0; i < array->n_children; ++i) {
+    if (array->children[i]->release) array->children[i]->release(array->children[i]);
+  }
+  array->release = nullptr;
+}
+
+size_t OGRWriterNode::write_arrow_batches(GDALDataset* dataSource, OGRLayer* layer, const std::vector<OGRAttributeWriter>& attribute_plan, bool group_parts, bool attributes_per_feature, bool do_transactions)
+{
+  auto& geom_term = vector_input("geometries");
+  auto& feature_index_term = vector_input("feature_index");
+  size_t geom_size = geom_term.size();
+  auto poDefn = layer->GetLayerDefn();
+
+  if (!layer->TestCapability(OLCFastWriteArrowBatch))
+    std::cout << "The " << dataSource->GetDriverName() << " driver converts Arrow batches to features, arrow_batch_size will not make writing faster\n";
+
+  // one column per written attribute, named after the layer field
+  using Type = OGRAttributeWriter::Type;
+  std::vector<std::unique_ptr<ArrowBatchColumn>> columns;
+  // DateTime columns that are converted to UTC
+  std::vector<bool> to_utc;
+  for (auto& writer : attribute_plan) {
+    std::string name = poDefn->GetFieldDefn(writer.field)->GetNameRef();
+    bool utc = false;
+    if (writer.type == Type::BOOL) {
+      columns.push_back(std::make_unique<ArrowBatchColumn>(ArrowBatchColumn::BOOL, name, "b"));
+    } else if (writer.type == Type::FLOAT) {
+      columns.push_back(std::make_unique<ArrowBatchColumn>(ArrowBatchColumn::FIXED, name, "g", sizeof(double)));
+    } else if (writer.type == Type::INT) {
+      columns.push_back(std::make_unique<ArrowBatchColumn>(ArrowBatchColumn::FIXED, name, "l", sizeof(int64_t)));
+    } else if (writer.type == Type::STRING || writer.type == Type::DICTIONARY) {
+      columns.push_back(std::make_unique<ArrowBatchColumn>(ArrowBatchColumn::BINARY, name, "u"));
+    } else if (writer.type == Type::DATE) {
+      columns.push_back(std::make_unique<ArrowBatchColumn>(ArrowBatchColumn::FIXED, name, "tdD", sizeof(int32_t)));
+    } else if (writer.type == Type::TIME) {
+      columns.push_back(std::make_unique<ArrowBatchColumn>(ArrowBatchColumn::FIXED, name, "ttm", sizeof(int32_t)));
+    } else {
+      // Arrow timestamps with a time zone are in UTC, times with an OGR time
+      // zone flag (100 = UTC, 15 minutes per step) are converted to UTC
+      for (auto& value : writer.term->get_data_vec()) {
+        if (value.has_value() && std::any_cast<const DateTime&>(value).time.timeZone > 1) utc = true;
+      }
+      columns.push_back(std::make_unique<ArrowBatchColumn>(ArrowBatchColumn::FIXED, name, utc ? "tsm:UTC" : "tsm:", sizeof(int64_t)));
+    }
+    to_utc.push_back(utc);
+  }
+
+  std::string geometry_name = layer->GetGeometryColumn();
+  if (geometry_name.empty()) geometry_name = "wkb_geometry";
+  columns.push_back(std::make_unique<ArrowBatchColumn>(ArrowBatchColumn::BINARY, geometry_name, "z"));
+  auto& geometry_column = *columns.back();
+  geometry_column.metadata = arrow_metadata("ARROW:extension:name", "ogc.wkb");
+
+  char** options = nullptr;
+  options = CSLSetNameValue(options, "GEOMETRY_NAME", geometry_name.c_str());
+
+  std::vector<ArrowSchema*> schema_children;
+  std::vector<ArrowArray*> array_children;
+  for (auto& column : columns) {
+    schema_children.push_back(&column->schema);
+    array_children.push_back(&column->array);
+  }
+  WKBBuffer wkb;
+  size_t batch_rows = 0, n_written = 0;
+
+  auto write_batch = [&]() {
+    if (batch_rows == 0) return;
+    ArrowSchema schema = ArrowSchema();
+    schema.format = "+s";
+    schema.name = "";
+    schema.n_children = int64_t(columns.size());
+    schema.children = schema_children.data();
+    schema.release = release_arrow_batch_schema;
+    const void* buffers[1] = {nullptr};
+    ArrowArray array = ArrowArray();
+    array.length = int64_t(batch_rows);
+    array.n_buffers = 1;
+    array.buffers = buffers;
+    array.n_children = int64_t(columns.size());
+    array.children = array_children.data();
+    array.release = release_arrow_batch_array;
+    for (auto& column : columns) column->export_column();
+
+    bool ok = layer->WriteArrowBatch(&schema, &array, options);
+    if (array.release) array.release(&array);
+    if (schema.release) schema.release(&schema);
+    if (!ok) {
+      CSLDestroy(options);
+      throw(gfException("Failed to write Arrow batch in " + std::string(dataSource->GetDriverName())));
+    }
+    n_written += batch_rows;
+    batch_rows = 0;
+    for (auto& column : columns) column->clear();
+
+    if (do_transactions) if (dataSource->CommitTransaction() != OGRERR_NONE) {
+      throw(gfException("Committing features to database failed.\n"));
+    }
+    if (do_transactions) if (dataSource->StartTransaction() != OGRERR_NONE) {
+      throw(gfException("Starting database transaction failed.\n"));
+    }
+  };
+
+  // appends the geometry in wkb and attribute row a as a row of the batch
+  // the size of the string or dictionary value of attribute row a in column
+  // c, 0 for the other types
+  auto value_size = [&](size_t c, size_t a) -> size_t {
+    auto& writer = attribute_plan[c];
+    auto& value = writer.term->get_data_vec()[a];
+    if (!value.has_value()) return 0;
+    if (writer.type == Type::STRING) return std::any_cast<const std::string&>(value).size();
+    if (writer.type == Type::DICTIONARY) return writer.dictionary->get<const std::string&>(std::any_cast<const int&>(value)).size();
+    return 0;
+  };
+  auto append_row = [&](size_t a) {
+    // the batch is written before the data of a binary column would pass the
+    // 2 GiB that its int32 offsets can address
+    bool fits = geometry_column.fits(wkb.bytes.size());
+    for (size_t c = 0; fits && c < attribute_plan.size(); ++c) fits = columns[c]->fits(value_size(c, a));
+    if (!fits) write_batch();
+
+    geometry_column.append_bytes(reinterpret_cast<const char*>(wkb.bytes.data()), wkb.bytes.size());
+
+    for (size_t c = 0; c < attribute_plan.size(); ++c) {
+      auto& writer = attribute_plan[c];
+      auto& column = *columns[c];
+      auto& value = writer.term->get_data_vec()[a];
+      if (!value.has_value()) {
+        column.append_null();
+        continue;
+      }
+      switch (writer.type) {
+        case Type::BOOL:
+          column.append_bool(std::any_cast<const bool&>(value));
+          break;
+        case Type::FLOAT:
+          column.append(double(std::any_cast<const float&>(value)));
+          break;
+        case Type::INT:
+          column.append(int64_t(std::any_cast<const int&>(value)));
+          break;
+        case Type::STRING: {
+          auto& val = std::any_cast<const std::string&>(value);
+          column.append_bytes(val.data(), val.size());
+          break;
+        }
+        case Type::DICTIONARY: {
+          auto& val = writer.dictionary->get<const std::string&>(std::any_cast<const int&>(value));
+          column.append_bytes(val.data(), val.size());
+          break;
+        }
+        case Type::DATE:
+          column.append(days_from_date(std::any_cast<const Date&>(value)));
+          break;
+        case Type::TIME:
+          column.append(int32_t(time_ms(std::any_cast<const Time&>(value))));
+          break;
+        case Type::DATETIME: {
+          auto& val = std::any_cast<const DateTime&>(value);
+          int64_t ms = days_from_date(val.date) * int64_t(86400000) + time_ms(val.time);
+          if (to_utc[c] && val.time.timeZone > 1)
+            ms -= (val.time.timeZone - 100) * int64_t(15 * 60 * 1000);
+          column.append(ms);
+          break;
+        }
+      }
+    }
+
+    if (++batch_rows == size_t(arrow_batch_size_)) write_batch();
+  };
+
+  for (size_t i = 0; i != geom_size; ++i) {
+    // with a feature_index the consecutive parts [i, part_end) of a feature
+    // are written as one MultiPolygon
+    size_t part_end = i + 1;
+    if (group_parts) {
+      while (part_end < geom_size && feature_index_term.get<int>(part_end) == feature_index_term.get<int>(i)) ++part_end;
+    }
+    // attribute row
+    size_t a = attributes_per_feature ? size_t(feature_index_term.get<int>(i)) : i;
+
+    wkb.clear();
+    if (group_parts) {
+      std::vector<const LinearRing*> parts;
+      for (size_t j = i; j < part_end; ++j) {
+        if (geom_term.get_data_vec()[j].has_value()) parts.push_back(&geom_term.get<const LinearRing&>(j));
+      }
+      wkb.header(wkbMultiPolygon);
+      wkb.append(uint32_t(parts.size()));
+      for (auto part : parts) append_wkb(*part, wkb);
+      i = part_end - 1;
+    } else if (!geom_term.get_data_vec()[i].has_value()) {
+      // like the feature by feature path, features without a geometry are skipped
+      continue;
+    } else if (geom_term.is_connected_type(typeid(LinearRing))) {
+      append_wkb(geom_term.get<const LinearRing&>(i), wkb);
+    } else if (geom_term.is_connected_type(typeid(LineString))) {
+      append_wkb(geom_term.get<const LineString&>(i), wkb);
+    } else if (geom_term.is_connected_type(typeid(Mesh))) {
+      append_wkb_multipolygon(geom_term.get<const Mesh&>(i).get_polygons(), wkb);
+    } else {
+      // a feature per TriangleCollection, with the same attributes
+      for (auto& tc : geom_term.get<const std::vector<TriangleCollection>&>(i)) {
+        wkb.clear();
+        append_wkb_multipolygon(tc, wkb);
+        append_row(a);
+      }
+      continue;
+    }
+    append_row(a);
+  }
+  write_batch();
+  CSLDestroy(options);
+  std::cout << "wrote " << n_written << " features in Arrow batches\n";
+  return n_written;
+}
+
+#endif
+
+/// Thread local GDAL configuration options, that are reset to their previous
+/// values when this goes out of scope
+class ScopedConfigOptions {
+  std::vector<std::pair<std::string, std::optional<std::string>>> previous_;
+
+public:
+  void set(const char* key, const char* value) {
+    auto old = CPLGetThreadLocalConfigOption(key, nullptr);
+    previous_.emplace_back(key, old ? std::optional<std::string>(old) : std::nullopt);
+    CPLSetThreadLocalConfigOption(key, value);
+  }
+  ~ScopedConfigOptions() {
+    for (auto it = previous_.rbegin(); it != previous_.rend(); ++it) {
+      CPLSetThreadLocalConfigOption(it->first.c_str(), it->second ? it->second->c_str() : nullptr);
+    }
+  }
+};
+
+/// Run a SQL statement and return the first value of its result as an
+/// integer, or 0 if there is none
+inline int64_t execute_sql_int(GDALDataset* dataSource, const std::string& sql) {
+  int64_t value = 0;
+  if (auto result = dataSource->ExecuteSQL(sql.c_str(), nullptr, nullptr)) {
+    if (auto feature = result->GetNextFeature()) {
+      value = feature->GetFieldAsInteger64(0);
+      OGRFeature::DestroyFeature(feature);
+    }
+    dataSource->ReleaseResultSet(result);
+  }
+  return value;
+}
+
+/// Run a SQL statement and return the first value of its result as a string,
+/// or an empty string if there is none
+inline std::string execute_sql_string(GDALDataset* dataSource, const std::string& sql) {
+  std::string value;
+  if (auto result = dataSource->ExecuteSQL(sql.c_str(), nullptr, nullptr)) {
+    if (auto feature = result->GetNextFeature()) {
+      value = feature->GetFieldAsString(0);
+      OGRFeature::DestroyFeature(feature);
+    }
+    dataSource->ReleaseResultSet(result);
+  }
+  return value;
+}
+
+/// The table and geometry column arguments of the GeoPackage spatial index
+/// SQL functions, as quoted string literals
+inline std::string spatial_index_args(OGRLayer* layer) {
+  auto literal = [](std::string value) {
+    return "'" + find_and_replace(value, "'", "''") + "'";
+  };
+  return literal(layer->GetName()) + ", " + literal(layer->GetGeometryColumn());
+}
+
+/// Run a SQL statement that does not return a result, and throw on errors
+inline void execute_sql(GDALDataset* dataSource, const std::string& sql) {
+  CPLErrorReset();
+  if (auto result = dataSource->ExecuteSQL(sql.c_str(), nullptr, nullptr)) dataSource->ReleaseResultSet(result);
+  if (CPLGetLastErrorType() == CE_Failure) {
+    throw(gfException("Executing '" + sql + "' failed: " + CPLGetLastErrorMsg()));
+  }
+}
+
+/// Quoted PostgreSQL identifier, a schema qualified name is quoted per part
+inline std::string pg_identifier(const std::string& name) {
+  auto dot = name.find('.');
+  if (dot != std::string::npos) return pg_identifier(name.substr(0, dot)) + "." + pg_identifier(name.substr(dot + 1));
+  return "\"" + find_and_replace(name, "\"", "\"\"") + "\"";
+}
+
+/// Move the features of a PostgreSQL staging table into the target table.
+/// Without a target_layer the staging table is made durable, indexed and then
+/// renamed to the target table, replacing an existing table. Otherwise its
+/// features are appended to target_layer. Either happens in one transaction.
+inline void swap_pg_staging_table(GDALDataset* dataSource, OGRLayer* staging_layer, OGRLayer* target_layer) {
+  const std::string staging_name = staging_layer->GetName();
+  const std::string staging = pg_identifier(staging_name);
+  const std::string geometry_column = staging_layer->GetGeometryColumn();
+
+  // the name of the target table and its schema prefix
+  std::string target_name = target_layer ? target_layer->GetName() : staging_name.substr(0, staging_name.size() - std::string("_staging").size());
+  std::string schema, table = target_name, staging_table = staging_name;
+  auto dot = target_name.find('.');
+  if (dot != std::string::npos) {
+    schema = pg_identifier(target_name.substr(0, dot)) + ".";
+    table = target_name.substr(dot + 1);
+    staging_table = staging_name.substr(staging_name.find('.') + 1);
+  }
+
+  if (!target_layer) {
+    std::cout << "indexing " << staging_name << "\n";
+    execute_sql(dataSource, "ALTER TABLE " + staging + " SET LOGGED");
+    execute_sql(dataSource, "CREATE INDEX " + pg_identifier(staging_table + "_" + geometry_column + "_geom_idx") + " ON " + staging + " USING GIST (" + pg_identifier(geometry_column) + ")");
+    execute_sql(dataSource, "ANALYZE " + staging);
+  }
+
+  if (dataSource->StartTransaction() != OGRERR_NONE) {
+    throw(gfException("Starting database transaction failed.\n"));
+  }
+  try {
+    if (target_layer) {
+      // the geometry column of the target table can have another name
+      std::string fields;
+      auto defn = staging_layer->GetLayerDefn();
+      for (int i = 0; i < defn->GetFieldCount(); ++i) {
+        fields += ", " + pg_identifier(defn->GetFieldDefn(i)->GetNameRef());
+      }
+      execute_sql(dataSource, "INSERT INTO " + pg_identifier(target_name) + " (" + pg_identifier(target_layer->GetGeometryColumn()) + fields + ") SELECT " + pg_identifier(geometry_column) + fields + " FROM " + staging);
+      execute_sql(dataSource, "DROP TABLE " + staging);
+    } else {
+      // the constraint, index and sequence that are named after the table are
+      // renamed as well, so that the next staging table can use their names
+      std::string fid_column = staging_layer->GetFIDColumn();
+      execute_sql(dataSource, "DROP TABLE IF EXISTS " + pg_identifier(target_name));
+      execute_sql(dataSource, "ALTER TABLE " + staging + " RENAME TO " + pg_identifier(table));
+      execute_sql(dataSource, "ALTER INDEX IF EXISTS " + schema + pg_identifier(staging_table + "_pk") + " RENAME TO " + pg_identifier(table + "_pk"));
+      execute_sql(dataSource, "ALTER INDEX IF EXISTS " + schema + pg_identifier(staging_table + "_" + geometry_column + "_geom_idx") + " RENAME TO " + pg_identifier(table + "_" + geometry_column + "_geom_idx"));
+      if (!fid_column.empty()) {
+        execute_sql(dataSource, "ALTER SEQUENCE IF EXISTS " + schema + pg_identifier(staging_table + "_" + fid_column + "_seq") + " RENAME TO " + pg_identifier(table + "_" + fid_column + "_seq"));
+      }
+    }
+  } catch (...) {
+    dataSource->RollbackTransaction();
+    throw;
+  }
+  if (dataSource->CommitTransaction() != OGRERR_NONE) {
+    throw(gfException("Committing features to database failed.\n"));
+  }
+  std::cout << (target_layer ? "appended " : "replaced ") << target_name << " with " << staging_name << "\n";
+}
+
+/// Rolls back and drops the PostgreSQL staging table of a load that is aborted
+/// by an exception, and closes the dataset
+class PGStagingGuard {
+  GDALDataset* dataSource_ = nullptr;
+  std::string staging_;
+
+public:
+  void arm(GDALDataset* dataSource, const std::string& staging) {
+    dataSource_ = dataSource;
+    staging_ = staging;
+  }
+  // the load has finished, the staging table is kept
+  void release() { dataSource_ = nullptr; }
+  ~PGStagingGuard() {
+    if (dataSource_ == nullptr) return;
+    dataSource_->RollbackTransaction();
+    auto sql = "DROP TABLE IF EXISTS " + pg_identifier(staging_);
+    if (auto result = dataSource_->ExecuteSQL(sql.c_str(), nullptr, nullptr)) dataSource_->ReleaseResultSet(result);
+    GDALClose(dataSource_);
+  }
+};
+
+/// The journal mode and synchronous setting of a SQLite connection, which a
+/// bulk load changes
+struct SQLiteDurability {
+  std::string journal_mode;
+  int64_t synchronous = 2;
+};
+
+/// Switch a SQLite connection to bulk load settings, without synchronous
+/// writes and with the rollback journal in memory. Returns the previous
+/// settings.
+inline SQLiteDurability begin_sqlite_bulk_load(GDALDataset* dataSource) {
+  SQLiteDurability previous{execute_sql_string(dataSource, "PRAGMA journal_mode"), execute_sql_int(dataSource, "PRAGMA synchronous")};
+  execute_sql(dataSource, "PRAGMA synchronous = OFF");
+  execute_sql(dataSource, "PRAGMA journal_mode = MEMORY");
+  return previous;
+}
+
+/// Restore the settings of a SQLite connection from before the bulk load. The
+/// driver still writes the layer extent and metadata when the dataset is
+/// closed, those writes are synced and journaled again. A WAL file stays in
+/// WAL mode, as that mode is stored in the file.
+inline void end_sqlite_bulk_load(GDALDataset* dataSource, const SQLiteDurability& previous) {
+  auto journal_mode = previous.journal_mode;
+  bool keyword = !journal_mode.empty() && std::all_of(journal_mode.begin(), journal_mode.end(), [](char c) { return std::isalpha((unsigned char)c); });
+  if (!keyword) journal_mode = "DELETE";
+  execute_sql(dataSource, "PRAGMA journal_mode = " + journal_mode);
+  execute_sql(dataSource, "PRAGMA synchronous = " + std::to_string(previous.synchronous));
+}
+
 void OGRWriterNode::process()
 {
   std::string connstr = manager.substitute_globals(conn_string_);
@@ -116,6 +934,18 @@ void OGRWriterNode::process()
     }
   }
 
+  // SQLite reads these settings when the dataset is opened. They are only
+  // changed for this thread and for the duration of the write.
+  bool bulk_load = bulk_load_ && (gdaldriver == "GPKG" || gdaldriver == "SQLite");
+  bool pg_copy = pg_copy_ && gdaldriver == "PostgreSQL";
+  bool do_transactions = do_transactions_ || bulk_load || pg_copy;
+  // every commit ends the COPY of the PostgreSQL driver, the unlogged staging
+  // table is loaded in one transaction instead, it is swapped in as a whole
+  bool batch_commits = do_transactions && !pg_copy;
+  ScopedConfigOptions config_options;
+  if (bulk_load) config_options.set("OGR_SQLITE_CACHE", std::to_string(bulk_load_cache_mb_).c_str());
+  if (pg_copy) config_options.set("PG_USE_COPY", "YES");
+
   GDALDataset* dataSource = nullptr;
   dataSource = (GDALDataset*) GDALOpenEx(connstr.c_str(), GDAL_OF_VECTOR|GDAL_OF_UPDATE, NULL, NULL, NULL);
   if (dataSource == nullptr) {
@@ -124,7 +954,11 @@ void OGRWriterNode::process()
   if (dataSource == nullptr) {
     throw(gfException("Starting database connection failed."));
   }
-  if (do_transactions_) if (dataSource->StartTransaction() != OGRERR_NONE) {
+  // the journal mode and synchronous setting are changed on the open
+  // connection, so that their previous values can be restored
+  SQLiteDurability sqlite_durability;
+  if (bulk_load) sqlite_durability = begin_sqlite_bulk_load(dataSource);
+  if (do_transactions) if (dataSource->StartTransaction() != OGRERR_NONE) {
     throw(gfException("Starting database transaction failed.\n"));
   }
 
@@ -147,8 +981,30 @@ void OGRWriterNode::process()
     wkbType = wkbMultiPolygon25D;
   }
   
+  // the parts of multipolygons from OGRLoader are regrouped using their
+  // feature_index, the attributes are given per part or per feature
+  auto& feature_index_term = vector_input("feature_index");
+  bool group_parts = feature_index_term.has_data() && geom_term.is_connected_type(typeid(LinearRing));
+  size_t n_features = 0;
+  if (group_parts) {
+    if (feature_index_term.size() != geom_term.size())
+      throw(gfException("Number of feature indices not equal to number of geometries"));
+    wkbType = wkbMultiPolygon;
+    for (size_t i = 0; i < feature_index_term.size(); ++i)
+      n_features = std::max(n_features, size_t(feature_index_term.get<int>(i)) + 1);
+  }
+  // the attributes are either all given per part or all given per feature,
+  // which is decided once from the first attribute term
+  bool attributes_per_feature = false;
+  auto attribute_terms = poly_input("attributes").sub_terminals();
+  if (group_parts && geom_term.size() != n_features && attribute_terms.size())
+    attributes_per_feature = attribute_terms.front()->get_data_vec().size() == n_features;
+  size_t n_attribute_rows = attributes_per_feature ? n_features : geom_term.size();
+
   std::unordered_map<std::string, size_t> attr_id_map;
   size_t fcnt(0);
+  // dictionary encoded attributes are written as strings
+  auto dictionaries = attribute_dictionaries(poly_input("attributes"), poly_input("attribute_dictionaries"));
   
   OGRLayer* layer = nullptr;
   char** lco = nullptr;
@@ -165,6 +1021,46 @@ void OGRWriterNode::process()
 
   bool supports_list_attributes = gdaldriver != "ESRI Shapefile" && gdaldriver != "FileGDB";
 
+  // PostgreSQL: the features are copied into a new unlogged staging table,
+  // which replaces or is appended to the target table in one transaction
+  // after the load. Readers never see a partially written table.
+  OGRLayer* target_layer = nullptr;
+  PGStagingGuard staging_guard;
+  if (pg_copy) {
+    target_layer = layer;
+    layer = nullptr;
+    lco = CSLSetNameValue(lco, "OVERWRITE", "YES");
+    lco = CSLSetNameValue(lco, "UNLOGGED", "YES");
+    lco = CSLSetNameValue(lco, "SPATIAL_INDEX", "NO");
+  }
+
+  // the spatial index is built in one pass after all features are written,
+  // instead of being updated for every inserted feature
+  bool deferred_spatial_index = deferred_spatial_index_ && (gdaldriver == "GPKG" || gdaldriver == "ESRI Shapefile");
+  if (deferred_spatial_index && layer == nullptr) lco = CSLSetNameValue(lco, "SPATIAL_INDEX", "NO");
+  else if (deferred_spatial_index && gdaldriver == "GPKG") {
+    // the R-tree of an existing layer is dropped and rebuilt, if it has one
+    if (execute_sql_int(dataSource, "SELECT HasSpatialIndex(" + spatial_index_args(layer) + ")")) {
+      execute_sql(dataSource, "SELECT DisableSpatialIndex(" + spatial_index_args(layer) + ")");
+    } else {
+      deferred_spatial_index = false;
+    }
+  }
+
+  // columnar writing, for the geometry types whose features only carry the
+  // attributes of the layer
+  bool arrow_batches = arrow_batch_size_ > 0;
+  if (arrow_batches && !geom_term.is_connected_type(typeid(LinearRing)) && !geom_term.is_connected_type(typeid(LineString)) && !geom_term.is_connected_type(typeid(Mesh)) && !geom_term.is_connected_type(typeid(std::vector<TriangleCollection>))) {
+    std::cout << "arrow_batch_size is only supported for LinearRing, LineString, Mesh and TriangleCollection geometries, writing features one by one\n";
+    arrow_batches = false;
+  }
+#if GDAL_VERSION_NUM < GDAL_COMPUTE_VERSION(3,8,0)
+  if (arrow_batches) {
+    std::cout << "arrow_batch_size requires GDAL 3.8 or newer, writing features one by one\n";
+    arrow_batches = false;
+  }
+#endif
+
   auto geom_size = geom_term.size();
   std::cout << "creating " << geom_size << " geometry features\n";
 
@@ -173,17 +1069,20 @@ void OGRWriterNode::process()
     OGRSpatialReference oSRS;
     oSRS.SetFromUserInput(CRS.c_str());
     // oSRS.SetAxisMappingStrategy(OAMS_AUTHORITY_COMPLIANT);
-    layer = dataSource->CreateLayer(layername.c_str(), &oSRS, wkbType, lco);
+    layer = dataSource->CreateLayer((pg_copy ? layername + "_staging" : layername).c_str(), &oSRS, wkbType, lco);
+    if (layer == nullptr)
+      throw(gfException("Creating layer " + layername + " failed"));
+    if (pg_copy) staging_guard.arm(dataSource, layer->GetName());
 
     // We set normalise_for_visualisation to true, becuase it seems that GDAL expects as the first coordinate easting/longitude when constructing geometries
     manager.set_rev_crs_transform(CRS.c_str(), true);
 
     // Create GDAL feature attributes
-    for (auto& term : poly_input("attributes").sub_terminals()) {
+    for (auto& term : attribute_terms) {
       std::string name = term->get_full_name();
       std::cout << "Field " << name << " has a size of " << term->get_data_vec().size() << std::endl;
-      if (geom_size != term->get_data_vec().size()) {
-        throw(gfException("Number of attributes not equal to number of geometries [field name =" + name + "]"));
+      if (term->get_data_vec().size() != n_attribute_rows) {
+        throw(gfException("Number of attributes not equal to number of " + std::string(attributes_per_feature ? "features" : "geometries") + " [field name =" + name + "]"));
       }
       //see if we need to rename this attribute
       auto search = output_attribute_names.find(name);
@@ -203,6 +1102,9 @@ void OGRWriterNode::process()
       } else if (term->accepts_type(typeid(float))) {
         create_field(layer, name, OFTReal);
         attr_id_map[term->get_full_name()] = fcnt++;
+      } else if (term->accepts_type(typeid(int)) && dictionaries.count(term->get_full_name())) {
+        create_field(layer, name, OFTString);
+        attr_id_map[term->get_full_name()] = fcnt++;
       } else if (term->accepts_type(typeid(int))) {
         create_field(layer, name, OFTInteger64);
         attr_id_map[term->get_full_name()] = fcnt++;
@@ -267,11 +1169,11 @@ void OGRWriterNode::process()
     // names to the gdal layer names
     // But: what if layer has a different set of attributes?
     fcnt = layer->GetLayerDefn()->GetFieldCount();
-    for (auto& term : poly_input("attributes").sub_terminals()) {
+    for (auto& term : attribute_terms) {
       std::string name = term->get_full_name();
       std::cout << "Field " << name << " has a size of " << term->get_data_vec().size() << std::endl;
-      if (geom_size != term->get_data_vec().size()) {
-        throw(gfException("Number of attributes not equal to number of geometries [field name =" + name + "]"));
+      if (term->get_data_vec().size() != n_attribute_rows) {
+        throw(gfException("Number of attributes not equal to number of " + std::string(attributes_per_feature ? "features" : "geometries") + " [field name =" + name + "]"));
       }
       //see if we need to rename this attribute
       auto search = output_attribute_names.find(name);
@@ -300,242 +1202,404 @@ void OGRWriterNode::process()
       }
     }
   }
-  if (do_transactions_) if (dataSource->CommitTransaction() != OGRERR_NONE) {
+  // the driver only creates a new table once it is used, the staging table
+  // is created now so that it exists whatever happens to the load
+  if (pg_copy) layer->GetFeatureCount();
+  if (do_transactions) if (dataSource->CommitTransaction() != OGRERR_NONE) {
     throw(gfException("Creating database transaction failed.\n"));
   }
-  if (do_transactions_) if (dataSource->StartTransaction() != OGRERR_NONE) {
+  if (do_transactions) if (dataSource->StartTransaction() != OGRERR_NONE) {
     throw(gfException("Starting database transaction failed.\n"));
   }
 
-  for (size_t i = 0; i != geom_term.size(); ++i) {
-    OGRFeature* poFeature;
-    poFeature = OGRFeature::CreateFeature(layer->GetLayerDefn());
-    // create a vec of features for the case where we write multiple feature rows (building with multiple parts)
-    std::vector<OGRFeature*> poFeatures;
-    // Add the attributes to the feature
-    for (auto& term : poly_input("attributes").sub_terminals()) {
-      if (!term->get_data_vec()[i].has_value()) continue;
-      auto tname = term->get_full_name();
-      
-      // skip if not added by user in output_attribute_names
-      auto search = output_attribute_names.find(tname);
-      if(only_output_mapped_attrs_ && search == output_attribute_names.end()) {
-        continue;
-      }
+  // field index, value type and setter of every written attribute
+  auto attribute_plan = attribute_write_plan(attr_id_map, dictionaries);
 
-      if (term->accepts_type(typeid(bool))) {
-        auto& val = term->get<const bool&>(i);
-        poFeature->SetField(attr_id_map[tname], val);
-      } else if (term->accepts_type(typeid(float))) {
-        auto& val = term->get<const float&>(i);
-        poFeature->SetField(attr_id_map[tname], val);
-      } else if (term->accepts_type(typeid(int))) {
-        auto& val = term->get<const int&>(i);
-        poFeature->SetField(attr_id_map[tname], val);
-      } else if (term->accepts_type(typeid(std::string))) {
-        auto& val = term->get<const std::string&>(i);
-        poFeature->SetField(attr_id_map[tname], val.c_str());
-      } else if (term->accepts_type(typeid(Date))) {
-        auto& val = term->get<const Date&>(i);
-        poFeature->SetField(attr_id_map[tname], val.year, val.month, val.day);
-      } else if (term->accepts_type(typeid(Time))) {
-        auto& val = term->get<const Time&>(i);
-        poFeature->SetField(attr_id_map[tname], 0, 0, 0, val.hour, val.minute, val.second, val.timeZone);
-      } else if (term->accepts_type(typeid(Time))) {
-        auto& val = term->get<const DateTime&>(i);
-        poFeature->SetField(attr_id_map[tname], val.date.year, val.date.month, val.date.day, val.time.hour, val.time.minute, val.time.second, val.time.timeZone);
+  // Without a CRS transformation the reverse transform only adds the data
+  // offset, and the vertices can be transformed without locking the manager.
+  // That is detected with a few probe vertices, a reprojection does not map
+  // them exactly to their offset coordinates.
+  auto offset = manager.data_offset().value_or(arr3d{0, 0, 0});
+  rev_offset_ = offset;
+  for (auto& p : {arr3f{0, 0, 0}, arr3f{1234.5f, -2345.25f, 12.5f}, arr3f{-98765.5f, 87654.75f, -100.f}}) {
+    auto t = manager.coord_transform_rev(p[0], p[1], p[2]);
+    for (int c = 0; c < 3; ++c) {
+      if (t[c] != double(p[c]) + offset[c]) rev_offset_.reset();
+    }
+  }
+
+  // commits the last transaction, builds the deferred spatial index and
+  // closes the dataset
+  size_t n_features_written = 0;
+  auto close_dataset = [&]() {
+    if (do_transactions) if (dataSource->CommitTransaction() != OGRERR_NONE) {
+      throw(gfException("Committing features to database failed.\n"));
+    }
+    if (deferred_spatial_index) {
+      std::cout << "building spatial index\n";
+      if (gdaldriver == "GPKG") {
+        execute_sql(dataSource, "SELECT CreateSpatialIndex(" + spatial_index_args(layer) + ")");
+      } else {
+        execute_sql(dataSource, "CREATE SPATIAL INDEX ON \"" + std::string(layer->GetName()) + "\"");
+      }
+    }
+    if (bulk_load) end_sqlite_bulk_load(dataSource, sqlite_durability);
+    if (pg_copy) {
+      // a staging table that was loaded completely is kept if the swap fails
+      staging_guard.release();
+      try {
+        if (n_features_written) {
+          swap_pg_staging_table(dataSource, layer, target_layer);
+        } else {
+          std::cout << "no features were written, the layer is left unchanged\n";
+          execute_sql(dataSource, "DROP TABLE IF EXISTS " + pg_identifier(layer->GetName()));
+        }
+      } catch (...) {
+        GDALClose(dataSource);
+        throw;
       }
     }
+    GDALClose(dataSource);
+  };
+
+#if GDAL_VERSION_NUM >= GDAL_COMPUTE_VERSION(3,8,0)
+  if (arrow_batches) {
+    n_features_written = write_arrow_batches(dataSource, layer, attribute_plan, group_parts, attributes_per_feature, batch_commits);
+    close_dataset();
+    return;
+  }
+#endif
+
+  // Builds the features of geometry i, or of all parts of the feature that
+  // starts at i, and returns the index of the next geometry. Runs on multiple
+  // threads at once, so it only reads from the inputs and attr_id_map.
+  auto poDefn = layer->GetLayerDefn();
+  auto field_id = [&attr_id_map](const std::string& name) {
+    // OGRFeature::SetField() ignores invalid field indices
+    auto it = attr_id_map.find(name);
+    return it == attr_id_map.end() ? -1 : int(it->second);
+  };
+  const int labels_field = field_id("labels");
+  const int building_part_id_field = field_id("building_part_id");
+  // the written features are returned to the pool and reused
+  OGRFeaturePool pool(poDefn);
+  auto create_features = [&](size_t i, std::vector<OGRFeature*>& poFeatures) -> size_t {
+    // with a feature_index the consecutive parts [i, part_end) of a feature
+    // are written as one MultiPolygon
+    size_t part_end = i + 1;
+    if (group_parts) {
+      while (part_end < geom_size && feature_index_term.get<int>(part_end) == feature_index_term.get<int>(i)) ++part_end;
+    }
+    // attribute row
+    size_t a = attributes_per_feature ? size_t(feature_index_term.get<int>(i)) : i;
+
+    OGRFeature* poFeature = pool.get();
+    // Add the attributes to the feature
+    for (auto& writer : attribute_plan) {
+      auto& value = writer.term->get_data_vec()[a];
+      if (value.has_value()) writer.set(*poFeature, writer, value);
+    }
+    // a feature for each part of a geometry, with the attributes of poFeature
+    auto part_feature = [&]() {
+      auto poFeature_ = pool.get();
+      copy_fields(*poFeature, *poFeature_);
+      return poFeature_;
+    };
 
     // Geometry input type handling for the feature
     // Cast the incoming geometry to the appropriate GDAL type. Note that this
-    // need to be in line with what is set for wkbType above.
-    if (!geom_term.get_data_vec()[i].has_value()) {
-      // set to an empty geometry
-      poFeature->SetGeometry(OGRGeometryFactory::createGeometry(wkbType));
+    // need to be in line with what is set for wkbType above. The geometries of
+    // pooled features are reused, so that their point buffers are not
+    // reallocated for every feature.
+    if (group_parts) {
+      auto ogrmultipoly = reuse_geometry<OGRMultiPolygon>(poFeature, wkbMultiPolygon);
+      int n_polys = 0;
+      for (size_t j = i; j < part_end; ++j) {
+        if (!geom_term.get_data_vec()[j].has_value()) continue;
+        set_polygon(geom_term.get<LinearRing>(j), *multipolygon_part(ogrmultipoly, n_polys++));
+      }
+      truncate_multipolygon(ogrmultipoly, n_polys);
+      poFeature->SetGeometryDirectly(ogrmultipoly);
+      poFeatures.push_back(poFeature);
+      i = part_end - 1;
+    } else if (!geom_term.get_data_vec()[i].has_value()) {
+      // features without a geometry are not written
+      pool.put(poFeature);
     } else {
       if (geom_term.is_connected_type(typeid(LinearRing))) {
         const LinearRing &lr = geom_term.get<LinearRing>(i);
-        OGRPolygon ogrpoly = create_polygon(lr);
-        poFeature->SetGeometry(&ogrpoly);
+        auto ogrpoly = reuse_geometry<OGRPolygon>(poFeature, wkbPolygon);
+        set_polygon(lr, *ogrpoly);
+        poFeature->SetGeometryDirectly(ogrpoly);
         poFeatures.push_back(poFeature);
       } else if (geom_term.is_connected_type(typeid(LineString))) {
-        OGRLineString ogrlinestring;
         const LineString &ls = geom_term.get<LineString>(i);
-        for (auto &g : ls) {
-          auto coord_t = manager.coord_transform_rev(g[0], g[1], g[2]);
-          ogrlinestring.addPoint(coord_t[0],
-                                 coord_t[1],
-                                 coord_t[2]);
-        }
-        poFeature->SetGeometry(&ogrlinestring);
+        auto ogrlinestring = reuse_geometry<OGRLineString>(poFeature, wkbLineString);
+        set_points(ls, *ogrlinestring, false);
+        poFeature->SetGeometryDirectly(ogrlinestring);
         poFeatures.push_back(poFeature);
       } else if (geom_term.is_connected_type(typeid(std::vector<TriangleCollection>))) {
-        OGRMultiPolygon ogrmultipoly = OGRMultiPolygon();
         auto& tcs = geom_term.get<std::vector<TriangleCollection>>(i);
 
-        for (auto& tc : tcs) {  
-          auto poFeature_ = poFeature->Clone();
+        for (auto& tc : tcs) {
+          auto poFeature_ = part_feature();
+          // one MultiPolygon per TriangleCollection
+          auto ogrmultipoly = reuse_geometry<OGRMultiPolygon>(poFeature_, wkbMultiPolygon);
+          int n_polys = 0;
           for (auto &triangle : tc) {
-            OGRPolygon ogrpoly = OGRPolygon();
-            OGRLinearRing ring = OGRLinearRing();
-            for (auto &vertex : triangle) {
-              auto coord_t = manager.coord_transform_rev(vertex[0], vertex[1], vertex[2]);
-              ring.addPoint(coord_t[0],
-                            coord_t[1],
-                            coord_t[2]);
-            }
-            ring.closeRings();
-            ogrpoly.addRing(&ring);
-            if (ogrmultipoly.addGeometry(&ogrpoly) != OGRERR_NONE) {
-              printf("couldn't add triangle to MultiSurfaceZ");
-            }
+            set_polygon(triangle, *multipolygon_part(ogrmultipoly, n_polys++));
           }
-          poFeature_->SetGeometry(&ogrmultipoly);
+          truncate_multipolygon(ogrmultipoly, n_polys);
+          poFeature_->SetGeometryDirectly(ogrmultipoly);
           poFeatures.push_back(poFeature_);
         }
-        OGRFeature::DestroyFeature(poFeature);
+        pool.put(poFeature);
       } else if (geom_term.is_connected_type(typeid(MultiTriangleCollection))) {
         auto&           mtcs = geom_term.get<MultiTriangleCollection>(i);
+        std::vector<int> int_values;
+        std::vector<double> real_values;
 
         for (size_t j=0; j<mtcs.tri_size(); j++) {
           const auto& tc = mtcs.tri_at(j);
-          auto poFeature_ = poFeature->Clone();
+          auto poFeature_ = part_feature();
 
-          // create an empty multipolygon for this TriangleCollection
-          OGRMultiPolygon ogrmultipoly = OGRMultiPolygon();
+          // a multipolygon for this TriangleCollection
+          auto ogrmultipoly = reuse_geometry<OGRMultiPolygon>(poFeature_, wkbMultiPolygon);
+          int n_polys = 0;
           for (auto& triangle : tc) {
-            OGRPolygon    ogrpoly = OGRPolygon();
-            OGRLinearRing ring    = OGRLinearRing();
-            for (auto& vertex : triangle) {
-              auto coord_t = manager.coord_transform_rev(vertex[0], vertex[1], vertex[2]);
-              ring.addPoint(coord_t[0],
-                            coord_t[1],
-                            coord_t[2]);
-            }
-            ring.closeRings();
-            ogrpoly.addRing(&ring);
-            if (ogrmultipoly.addGeometry(&ogrpoly) != OGRERR_NONE) {
-              printf("couldn't add triangle to MultiPolygonZ");
-            }
+            set_polygon(triangle, *multipolygon_part(ogrmultipoly, n_polys++));
           }
-          poFeature_->SetGeometry(&ogrmultipoly);
+          truncate_multipolygon(ogrmultipoly, n_polys);
+          poFeature_->SetGeometryDirectly(ogrmultipoly);
           if (mtcs.has_attributes()) {
             for (const auto& attr_map : mtcs.attr_at(j)) {
-              if (attr_map.second.empty()) poFeature_->SetFieldNull(attr_id_map[attr_map.first]);
+              int field = field_id(attr_map.first);
+              auto& values = attr_map.second;
+              if (values.empty()) poFeature_->SetFieldNull(field);
               else {
                 // Since the 'attribute_value' type is a 'variant' and therefore
                 // the 'attr_map' AttributeMap is a vector of variants, the
                 // SetField method does not recognize the data type stored
                 // within the variant. So it doesn't write the values unless we
-                // put the values into an array with an explicit type. I tried
-                // passing attr_map.second.data() to SetField but doesn't work.
-                attribute_value v = attr_map.second[0];
+                // put the values into an array with an explicit type. The
+                // arrays are reused for all TriangleCollections.
+                auto& v = values[0];
                 if (std::holds_alternative<int>(v)) {
-                  std::vector<int> val(attr_map.second.size());
-                  for (size_t h=0; h<attr_map.second.size(); h++) {
-                    val[h] = std::get<int>(attr_map.second[h]);
+                  int_values.resize(values.size());
+                  for (size_t h=0; h<values.size(); h++) {
+                    int_values[h] = std::get<int>(values[h]);
                   }
-                  poFeature_->SetField(attr_id_map[attr_map.first], attr_map.second.size(), val.data());
+                  poFeature_->SetField(field, int(values.size()), int_values.data());
                 }
                 else if (std::holds_alternative<float>(v)) {
-                  std::vector<double> val(attr_map.second.size());
-                  for (size_t h=0; h<attr_map.second.size(); h++) {
-                    val[h] = (double) std::get<float>(attr_map.second[h]);
+                  real_values.resize(values.size());
+                  for (size_t h=0; h<values.size(); h++) {
+                    real_values[h] = (double) std::get<float>(values[h]);
                   }
-                  poFeature_->SetField(attr_id_map[attr_map.first], attr_map.second.size(), val.data());
+                  poFeature_->SetField(field, int(values.size()), real_values.data());
                 }
                 else if (std::holds_alternative<std::string>(v)) {
                   // FIXME: needs to align the character encoding with the encoding of the database, otherwise will throw an 'ERROR:  invalid byte sequence for encoding ...'
-//                  const char* val[attr_map.second.size()];
-//                  for (size_t h=0; h<attr_map.second.size(); h++) {
-//                    val[h] = std::get<std::string>(attr_map.second[h]).c_str();
+//                  const char* val[values.size()];
+//                  for (size_t h=0; h<values.size(); h++) {
+//                    val[h] = std::get<std::string>(values[h]).c_str();
 //                  }
-//                  poFeature_->SetField(attr_id_map[attr_map.first], attr_map.second.size(), val);
+//                  poFeature_->SetField(field, values.size(), val);
                 }
                 else if (std::holds_alternative<bool>(v)) {
-                  std::vector<int> val(attr_map.second.size());
-                  for (size_t h=0; h<attr_map.second.size(); h++) {
-                    val[h] = std::get<bool>(attr_map.second[h]);
+                  int_values.resize(values.size());
+                  for (size_t h=0; h<values.size(); h++) {
+                    int_values[h] = std::get<bool>(values[h]);
                   }
-                  poFeature_->SetField(attr_id_map[attr_map.first], attr_map.second.size(), val.data());
+                  poFeature_->SetField(field, int(values.size()), int_values.data());
                 }
                 else throw(gfException("Unsupported attribute value type for: " + attr_map.first));
               }
             }
 
             auto bp_id = std::to_string(mtcs.building_part_ids_[j]);
-            poFeature_->SetField(attr_id_map["building_part_id"], bp_id.c_str());
+            poFeature_->SetField(building_part_id_field, bp_id.c_str());
           }
           poFeatures.push_back(poFeature_);
         }
-        OGRFeature::DestroyFeature(poFeature);
+        pool.put(poFeature);
       } else if (geom_term.is_connected_type(typeid(Mesh))) {
         auto&           mesh         = geom_term.get<Mesh>(i);
-        OGRMultiPolygon ogrmultipoly = OGRMultiPolygon();
+        auto ogrmultipoly = reuse_geometry<OGRMultiPolygon>(poFeature, wkbMultiPolygon);
+        int n_polys = 0;
         for (auto& poly : mesh.get_polygons()) {
-          auto ogrpoly = create_polygon(poly);
-          if (ogrmultipoly.addGeometry(&ogrpoly) != OGRERR_NONE) {
-            printf("couldn't add polygon to MultiPolygon");
-          }
+          set_polygon(poly, *multipolygon_part(ogrmultipoly, n_polys++));
         }
-        poFeature->SetGeometry(&ogrmultipoly);
+        truncate_multipolygon(ogrmultipoly, n_polys);
+        poFeature->SetGeometryDirectly(ogrmultipoly);
         poFeatures.push_back(poFeature);
       } else if (geom_term.is_connected_type(typeid(std::unordered_map<int, Mesh>))) {
-        const auto& meshes = geom_term.get<std::unordered_map<int, Mesh>>(i);
-
         for ( const auto& [mid, mesh] : geom_term.get<std::unordered_map<int, Mesh>>(i) ) {
-          auto poFeature_ = poFeature->Clone();
+          auto poFeature_ = part_feature();
 
-          OGRMultiPolygon ogrmultipoly = OGRMultiPolygon();
+          auto ogrmultipoly = reuse_geometry<OGRMultiPolygon>(poFeature_, wkbMultiPolygon);
+          int n_polys = 0;
           for (auto& poly : mesh.get_polygons()) {
-            auto ogrpoly = create_polygon(poly);
-            if (ogrmultipoly.addGeometry(&ogrpoly) != OGRERR_NONE) {
-              printf("couldn't add polygon to MultiPolygonZ");
-            }
+            set_polygon(poly, *multipolygon_part(ogrmultipoly, n_polys++));
           }
+          truncate_multipolygon(ogrmultipoly, n_polys);
 
           if(supports_list_attributes) {
-            size_t label_size = mesh.get_labels().size();
-            std::vector<int> val(label_size);
-            val = mesh.get_labels();
-            poFeature_->SetField(attr_id_map["labels"], label_size, val.data());
+            auto& labels = mesh.get_labels();
+            poFeature_->SetField(labels_field, int(labels.size()), labels.data());
           }
 
           auto bp_id = std::to_string(mid);
-          poFeature_->SetField(attr_id_map["building_part_id"], bp_id.c_str());
+          poFeature_->SetField(building_part_id_field, bp_id.c_str());
 
-          poFeature_->SetGeometry(&ogrmultipoly);
+          poFeature_->SetGeometryDirectly(ogrmultipoly);
           poFeatures.push_back(poFeature_);
         }
-        OGRFeature::DestroyFeature(poFeature);
+        pool.put(poFeature);
       } else {
         std::cerr << "Unsupported type of input geometry " << geom_term.get_connected_type().name() << std::endl;
+        pool.put(poFeature);
       }
     }
+    return i + 1;
+  };
 
-    for (auto poFeat : poFeatures) {
-      if (layer->CreateFeature(poFeat) != OGRERR_NONE) {
+  // a transaction is committed after transaction_batch_size_ written
+  // features or transaction_batch_mb_ of written geometry, whichever is first
+  size_t transaction_rows = 0, transaction_bytes = 0;
+  const size_t max_transaction_bytes = size_t(std::max(transaction_batch_mb_, 0)) << 20;
+  auto write_features = [&](std::vector<OGRFeature*>& poFeatures) {
+    for (size_t f = 0; f < poFeatures.size(); ++f) {
+      if (layer->CreateFeature(poFeatures[f]) != OGRERR_NONE) {
+        for (; f < poFeatures.size(); ++f) OGRFeature::DestroyFeature(poFeatures[f]);
+        poFeatures.clear();
         throw(gfException("Failed to create feature in "+gdaldriver));
       }
-      OGRFeature::DestroyFeature(poFeat);
+      ++n_features_written;
+      if (!batch_commits) {
+        pool.put(poFeatures[f]);
+        continue;
+      }
+      if (max_transaction_bytes) {
+        if (auto geometry = poFeatures[f]->GetGeometryRef()) transaction_bytes += geometry->WkbSize();
+      }
+      pool.put(poFeatures[f]);
+      if (++transaction_rows >= size_t(transaction_batch_size_) || (max_transaction_bytes && transaction_bytes >= max_transaction_bytes)) {
+        if (dataSource->CommitTransaction() != OGRERR_NONE) {
+          for (++f; f < poFeatures.size(); ++f) OGRFeature::DestroyFeature(poFeatures[f]);
+          poFeatures.clear();
+          throw(gfException("Committing features to database failed.\n"));
+        }
+        if (dataSource->StartTransaction() != OGRERR_NONE) {
+          for (++f; f < poFeatures.size(); ++f) OGRFeature::DestroyFeature(poFeatures[f]);
+          poFeatures.clear();
+          throw(gfException("Starting database transaction failed.\n"));
+        }
+        transaction_rows = transaction_bytes = 0;
+      }
     }
+    poFeatures.clear();
+  };
 
-    if (i % transaction_batch_size_ == 0) {
-      if (do_transactions_) if (dataSource->CommitTransaction() != OGRERR_NONE) {
-        throw(gfException("Committing features to database failed.\n"));
-      }
-      if (do_transactions_) if (dataSource->StartTransaction() != OGRERR_NONE) {
-        throw(gfException("Starting database transaction failed.\n"));
+  size_t n_threads = n_threads_ > 0 ? size_t(n_threads_) : std::max(1u, std::thread::hardware_concurrency());
+  if (n_threads <= 1) {
+    std::vector<OGRFeature*> poFeatures;
+    for (size_t i = 0; i != geom_size;) {
+      i = create_features(i, poFeatures);
+      write_features(poFeatures);
+    }
+  } else {
+    // Producer/consumer pipeline: the worker threads build the features of
+    // chunks of geometries, this thread writes the chunks in order, since the
+    // drivers only support a single writer. Workers stay at most a few chunks
+    // ahead of the writer, to bound the memory use.
+    struct FeatureChunk {
+      size_t begin, end;
+      std::vector<OGRFeature*> features;
+      bool done = false;
+      std::exception_ptr error;
+    };
+    std::vector<FeatureChunk> chunks;
+    const size_t chunk_size = 256;
+    for (size_t begin = 0; begin < geom_size;) {
+      size_t end = std::min(begin + chunk_size, geom_size);
+      // the parts of a feature stay in the same chunk
+      if (group_parts) {
+        while (end < geom_size && feature_index_term.get<int>(end) == feature_index_term.get<int>(end - 1)) ++end;
       }
+      chunks.push_back({begin, end});
+      begin = end;
     }
-  }
 
-  if (do_transactions_) if (dataSource->CommitTransaction() != OGRERR_NONE) {
-    throw(gfException("Committing features to database failed.\n"));
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t next_chunk = 0, n_written = 0;
+    bool stop = false;
+    const size_t max_ahead = 2 * n_threads;
+    auto worker = [&]() {
+      while (true) {
+        size_t k;
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cv.wait(lock, [&]() { return stop || next_chunk >= chunks.size() || next_chunk < n_written + max_ahead; });
+          if (stop || next_chunk >= chunks.size()) return;
+          k = next_chunk++;
+        }
+        auto& chunk = chunks[k];
+        try {
+          for (size_t i = chunk.begin; i < chunk.end;) i = create_features(i, chunk.features);
+        } catch (...) {
+          chunk.error = std::current_exception();
+        }
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          chunk.done = true;
+        }
+        cv.notify_all();
+      }
+    };
+    n_threads = std::min(n_threads, chunks.size());
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < n_threads; ++t) threads.emplace_back(worker);
+
+    std::exception_ptr error;
+    std::vector<OGRFeature*> poFeatures;
+    try {
+      for (size_t k = 0; k < chunks.size(); ++k) {
+        auto& chunk = chunks[k];
+        {
+          std::unique_lock<std::mutex> lock(mutex);
+          cv.wait(lock, [&]() { return chunk.done; });
+        }
+        if (chunk.error) std::rethrow_exception(chunk.error);
+        // the writer owns the features from here on
+        poFeatures.swap(chunk.features);
+        write_features(poFeatures);
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          n_written = k + 1;
+        }
+        cv.notify_all();
+      }
+    } catch (...) {
+      error = std::current_exception();
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+      }
+      cv.notify_all();
+    }
+    for (auto& thread : threads) thread.join();
+    if (error) {
+      // features that were built but not written
+      for (auto& chunk : chunks) {
+        for (auto poFeat : chunk.features) OGRFeature::DestroyFeature(poFeat);
+      }
+      std::rethrow_exception(error);
+    }
   }
 
-  GDALClose(dataSource);
+  close_dataset();
 //  GDALClose(driver);
 }
 
@@ -0,0 +1,206 @@
+// This file is part of gfp-gdal
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+// Parser and evaluator tests of OGRAttributeFilter, the in-memory
+// attribute_filter of OGRLoader
+#include "../gdal_nodes.hpp"
+
+#include <iostream>
+
+using namespace geoflow;
+using namespace geoflow::nodes::gdal;
+
+static int n_failed = 0;
+
+#define CHECK(condition) \
+  if (!(condition)) { \
+    std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+    ++n_failed; \
+  }
+
+template <typename T> OGRAttributeColumn make_column(const std::string& name, std::vector<std::any> values) {
+  OGRAttributeColumn column{name, typeid(T), 0};
+  column.values = std::move(values);
+  return column;
+}
+
+/// Four attribute rows with a NULL in every column
+OGRLayerData make_layer(const std::string& driver_name) {
+  OGRLayerData data;
+  data.layer_name = "test";
+  data.driver_name = driver_name;
+  data.columns.push_back(make_column<int>("height", {10, 25, std::any(), -3}));
+  data.columns.push_back(make_column<float>("area", {1.5f, 0.1f, 200.f, std::any()}));
+  data.columns.push_back(make_column<std::string>("name", {std::string("Dam 1"), std::string("dam 2"), std::string("Spui"), std::any()}));
+  data.columns.push_back(make_column<bool>("flag", {true, false, std::any(), true}));
+  data.columns.push_back(make_column<Date>("built", {Date{1990, 5, 1}, Date{2021, 12, 31}, std::any(), Date{2000, 1, 1}}));
+  data.columns.push_back(make_column<DateTime>("edited", {DateTime{{2020, 1, 2}, {13, 30, 0, 0}}, std::any(), DateTime{{2020, 1, 2}, {8, 0, 0, 0}}, DateTime{{2019, 6, 1}, {0, 0, 0, 0}}}));
+  // dictionary encoded strings, code 2 is out of range
+  auto use = make_column<int>("use", {0, 1, 1, 2});
+  use.is_dictionary = true;
+  use.dictionary = {"residential", "office"};
+  data.columns.push_back(std::move(use));
+  auto fid = make_column<int>("fid_column", {1, 2, 3, 4});
+  fid.field_index = -1;
+  data.columns.push_back(std::move(fid));
+  return data;
+}
+
+/// The rows that satisfy an expression, as a string of 0 and 1
+std::string rows(const std::string& expression, const std::string& driver_name = "ESRI Shapefile") {
+  auto data = make_layer(driver_name);
+  OGRAttributeFilter filter(expression);
+  if (!filter.bind(data)) return "unbound";
+  std::string result;
+  for (size_t i = 0; i < 4; ++i) result += filter.evaluate(i) ? '1' : '0';
+  return result;
+}
+
+bool parses(const std::string& expression) {
+  try {
+    OGRAttributeFilter filter(expression);
+    return true;
+  } catch (const gfException&) {
+    return false;
+  }
+}
+
+void test_parser() {
+  CHECK(parses("height > 10"));
+  CHECK(parses("(height > 10 OR area < 1) AND NOT name IS NULL"));
+  CHECK(parses("height IN (1, 2, -3)"));
+  CHECK(parses("\"na\"\"me\" = 'it''s'"));
+  CHECK(parses("height BETWEEN 1 AND 2 AND area = 3"));
+  CHECK(!parses(""));
+  CHECK(!parses("height >"));
+  CHECK(!parses("(height > 1"));
+  CHECK(!parses("height > 1)"));
+  CHECK(!parses("name = 'unterminated"));
+  CHECK(!parses("height # 1"));
+  CHECK(!parses("name IS 1"));
+  CHECK(!parses("upper(name) = 'DAM'"));
+  CHECK(!parses("name LIKE 'a%' ESCAPE '\\'"));
+  CHECK(!parses("height BETWEEN 1 OR 2"));
+}
+
+void test_identifiers() {
+  auto identifiers = OGRAttributeFilter::identifiers("height > 1 AND \"my field\" LIKE 'x' OR name IS NULL");
+  std::vector<std::string> expected = {"height", "AND", "my field", "LIKE", "OR", "name", "IS", "NULL"};
+  CHECK(identifiers == expected);
+}
+
+void test_comparisons() {
+  CHECK(rows("height > 10") == "0100");
+  CHECK(rows("height >= 10") == "1100");
+  CHECK(rows("height = 10") == "1000");
+  CHECK(rows("height == 10") == "1000");
+  CHECK(rows("height <> 10") == "0101");
+  CHECK(rows("height != 10") == "0101");
+  CHECK(rows("height < 0") == "0001");
+  CHECK(rows("-height = 3") == "0001");
+  CHECK(rows("height * 2 + 5 = 25") == "1000");
+  CHECK(rows("height % 4 = 1") == "0100");
+  CHECK(rows("height / 0 = 1") == "0000");
+  // float columns are compared in single precision
+  CHECK(rows("area = 0.1") == "0100");
+  CHECK(rows("area > 1") == "1010");
+  CHECK(rows("name = 'Spui'") == "0010");
+  CHECK(rows("name < 'a'") == "1010");
+  // strings are converted to the type of the column
+  CHECK(rows("height = '25'") == "0100");
+  CHECK(rows("height = 'abc'") == "0000");
+  CHECK(rows("flag = 1") == "1001");
+  CHECK(rows("flag = TRUE") == "1001");
+  CHECK(rows("flag") == "1001");
+  CHECK(rows("FID = 2") == "0100");
+  CHECK(rows("HEIGHT = 10") == "1000");
+}
+
+void test_null_logic() {
+  // comparisons with NULL are unknown, which is not true
+  CHECK(rows("height > 0") == "1100");
+  CHECK(rows("NOT height > 0") == "0001");
+  CHECK(rows("height = NULL") == "0000");
+  CHECK(rows("height IS NULL") == "0010");
+  CHECK(rows("height IS NOT NULL") == "1101");
+  // unknown OR true is true, unknown AND false is false
+  CHECK(rows("height > 0 OR area > 100") == "1110");
+  CHECK(rows("NOT (height > 0 AND area < 100)") == "0011");
+  CHECK(rows("NOT (height > 0 OR area > 100)") == "0000");
+  CHECK(rows("height IN (10, NULL)") == "1000");
+  CHECK(rows("height NOT IN (10, NULL)") == "0000");
+  CHECK(rows("height NOT IN (10, 25)") == "0001");
+}
+
+void test_predicates() {
+  CHECK(rows("height IN (10, -3)") == "1001");
+  CHECK(rows("name IN ('Spui', 'Dam 1')") == "1010");
+  CHECK(rows("height BETWEEN 0 AND 25") == "1100");
+  CHECK(rows("height NOT BETWEEN 0 AND 20") == "0101");
+  CHECK(rows("name LIKE 'Dam%'") == "1000");
+  CHECK(rows("name LIKE '_am _'") == "1100");
+  CHECK(rows("name LIKE '%p%'") == "0010");
+  CHECK(rows("name NOT LIKE 'Dam%'") == "0110");
+  CHECK(rows("name ILIKE 'dam%'") == "1100");
+  CHECK(rows("name NOT ILIKE 'DAM%'") == "0010");
+}
+
+void test_like_case() {
+  // LIKE is matched the way the driver of the data does
+  CHECK(rows("name LIKE 'dam%'", "ESRI Shapefile") == "0100");
+  CHECK(rows("name LIKE 'dam%'", "PostgreSQL") == "0100");
+  CHECK(rows("name LIKE 'dam%'", "GPKG") == "1100");
+  CHECK(rows("name LIKE 'dam%'", "SQLite") == "1100");
+  CHECK(rows("name LIKE 'dam%'", "MySQL") == "unbound");
+  CHECK(rows("name ILIKE 'dam%'", "GPKG") == "1100");
+  CHECK(rows("name = 'dam 1'", "GPKG") == "0000");
+}
+
+void test_dates_and_dictionaries() {
+  CHECK(rows("built > '2000-01-01'") == "0100");
+  CHECK(rows("built >= '2000/01/01'") == "0101");
+  CHECK(rows("built BETWEEN '1990-01-01' AND '2000-12-31'") == "1001");
+  CHECK(rows("edited > '2020-01-02 12:00:00'") == "1000");
+  CHECK(rows("edited < '2020-01-02T12:00:00'") == "0011");
+  CHECK(rows("built = 'not a date'") == "0000");
+  // dictionary codes are compared as their strings
+  CHECK(rows("use = 'office'") == "0110");
+  CHECK(rows("use LIKE 'res%'") == "1000");
+  CHECK(rows("use IS NULL") == "0001");
+}
+
+void test_bind() {
+  auto data = make_layer("GPKG");
+  OGRAttributeFilter filter("missing = 1");
+  CHECK(!filter.bind(data));
+}
+
+int main() {
+  test_parser();
+  test_identifiers();
+  test_comparisons();
+  test_null_logic();
+  test_predicates();
+  test_like_case();
+  test_dates_and_dictionaries();
+  test_bind();
+  if (n_failed) {
+    std::cerr << n_failed << " check(s) failed\n";
+    return 1;
+  }
+  std::cout << "all checks passed\n";
+  return 0;
+}